@@ -0,0 +1,39 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// Shared reporting bits for the runtime microbenchmarks
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <x86intrin.h>
+
+#include "swarm/hooks.h"
+
+namespace bench {
+
+static inline uint64_t cycles() { return __rdtsc(); }
+
+// Mark a phase boundary for the simulator's stats and print one result row
+static inline void report(const char* name, uint64_t units, uint64_t cycles) {
+    zsim_heartbeat();
+    printf("[BENCH] %-28s %12lu units %14lu cycles %10.2f cycles/unit\n",
+           name, units, cycles, units ? (double)cycles / units : 0.0);
+}
+
+} // namespace bench
@@ -0,0 +1,63 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// Latency of the complete-tree enqueue_all: time from kicking off the tree
+// until a CANTSPEC task ordered after all the leaves runs, for a range of
+// sizes. This exercises the enqueuer tree expansion (and the TaskBatch
+// magic-op path where it applies), not the leaf tasks, which are empty.
+
+#include "swarm/api.h"
+#include "swarm/algorithm.h"
+#include "common.h"
+
+namespace {
+
+constexpr uint32_t kMinLgSize = 6;
+constexpr uint32_t kMaxLgSize = 18;
+
+uint64_t startCycles;
+
+void leaf(swarm::Timestamp, uint64_t) {}
+
+void kickoff(swarm::Timestamp ts, uint64_t lgsize);
+
+void finish(swarm::Timestamp ts, uint64_t lgsize) {
+    char name[64];
+    snprintf(name, sizeof(name), "enqueue_all 2^%lu", lgsize);
+    bench::report(name, 1ul << lgsize, bench::cycles() - startCycles);
+    if (lgsize < kMaxLgSize)
+        swarm::enqueue(kickoff, ts + 1, EnqFlags::NOHINT, lgsize + 1);
+}
+
+void kickoff(swarm::Timestamp ts, uint64_t lgsize) {
+    startCycles = bench::cycles();
+    swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(
+            swarm::u64it(0ul), swarm::u64it(1ul << lgsize),
+            [] (swarm::Timestamp ts, uint64_t i) {
+        swarm::enqueue(leaf, ts, EnqFlags::NOHINT, i);
+    }, ts);
+    swarm::enqueue(finish, ts + 1, EnqFlags(NOHINT | CANTSPEC), lgsize);
+}
+
+} // anonymous namespace
+
+int main() {
+    swarm::enqueue(kickoff, 0, EnqFlags::NOHINT, (uint64_t)kMinLgSize);
+    swarm::run();
+    return 0;
+}
@@ -0,0 +1,105 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// Raw swarm::enqueue throughput across argument counts, covering the
+// argument-passing paths of impl/hwtasks.h: few arguments travel in
+// registers, mid-size argument lists go through a register-packed tuple,
+// and large ones spill to a heap-allocated tuple (memTupleRunner). A
+// driver task times a batch of enqueues, chains itself SAMETASK-style for
+// kReps rounds, then hands off to the next arity.
+
+#include "swarm/api.h"
+#include "swarm/algorithm.h"
+#include "common.h"
+
+namespace {
+
+constexpr uint32_t kBatch = swarm::max_children - 1;
+constexpr uint32_t kReps = 256;
+
+uint64_t sink = 0;
+
+void t0(swarm::Timestamp) {}
+void t2(swarm::Timestamp, uint64_t a, uint64_t b) { sink += a + b; }
+void t4(swarm::Timestamp, uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
+    sink += a + b + c + d;
+}
+void t6(swarm::Timestamp, uint64_t a, uint64_t b, uint64_t c, uint64_t d,
+        uint64_t e, uint64_t f) {
+    sink += a + b + c + d + e + f;
+}
+
+void report(const char* name, uint64_t total) {
+    bench::report(name, (uint64_t)kBatch * kReps, total);
+}
+
+// Drivers chain at ts+2 so their enqueues at ts+1 drain between rounds
+void driver6(swarm::Timestamp ts, uint64_t reps, uint64_t total) {
+    uint64_t start = bench::cycles();
+    for (uint32_t i = 0; i < kBatch; i++)
+        swarm::enqueue(t6, ts + 1, EnqFlags::NOHINT, 1ul, 2ul, 3ul, 4ul, 5ul,
+                       6ul);
+    total += bench::cycles() - start;
+    if (--reps) swarm::enqueue(driver6, ts + 2, EnqFlags::NOHINT, reps, total);
+    else report("enqueue 6 args (memTuple)", total);
+}
+
+void driver4(swarm::Timestamp ts, uint64_t reps, uint64_t total) {
+    uint64_t start = bench::cycles();
+    for (uint32_t i = 0; i < kBatch; i++)
+        swarm::enqueue(t4, ts + 1, EnqFlags::NOHINT, 1ul, 2ul, 3ul, 4ul);
+    total += bench::cycles() - start;
+    if (--reps) swarm::enqueue(driver4, ts + 2, EnqFlags::NOHINT, reps, total);
+    else {
+        report("enqueue 4 args (regTuple)", total);
+        swarm::enqueue(driver6, ts + 2, EnqFlags::NOHINT, (uint64_t)kReps, 0ul);
+    }
+}
+
+void driver2(swarm::Timestamp ts, uint64_t reps, uint64_t total) {
+    uint64_t start = bench::cycles();
+    for (uint32_t i = 0; i < kBatch; i++)
+        swarm::enqueue(t2, ts + 1, EnqFlags::NOHINT, 1ul, 2ul);
+    total += bench::cycles() - start;
+    if (--reps) swarm::enqueue(driver2, ts + 2, EnqFlags::NOHINT, reps, total);
+    else {
+        report("enqueue 2 args (regs)", total);
+        swarm::enqueue(driver4, ts + 2, EnqFlags::NOHINT, (uint64_t)kReps, 0ul);
+    }
+}
+
+void driver0(swarm::Timestamp ts, uint64_t reps, uint64_t total) {
+    uint64_t start = bench::cycles();
+    for (uint32_t i = 0; i < kBatch; i++)
+        swarm::enqueue(t0, ts + 1, EnqFlags::NOHINT);
+    total += bench::cycles() - start;
+    if (--reps) swarm::enqueue(driver0, ts + 2, EnqFlags::NOHINT, reps, total);
+    else {
+        report("enqueue 0 args (regs)", total);
+        swarm::enqueue(driver2, ts + 2, EnqFlags::NOHINT, (uint64_t)kReps, 0ul);
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    swarm::enqueue(driver0, 0, EnqFlags::NOHINT, (uint64_t)kReps, 0ul);
+    swarm::run();
+    printf("[BENCH] sink %lu\n", sink);  // defeat dead-code elimination
+    return 0;
+}
@@ -0,0 +1,75 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// Bandwidth of the parallel building blocks: swarm::fill, swarm::copy, and
+// swarm::reduce over a large array, one phase per timestamp with CANTSPEC
+// boundary tasks taking the cycle readings. Units are bytes touched, so
+// cycles/unit is the inverse of achieved bytes/cycle.
+
+#include "swarm/api.h"
+#include "swarm/algorithm.h"
+#include "swarm/numeric.h"
+#include "common.h"
+
+namespace {
+
+constexpr uint64_t kElems = 1ul << 22;
+constexpr uint64_t kBytes = kElems * sizeof(uint64_t);
+
+uint64_t* src;
+uint64_t* dst;
+uint64_t startCycles;
+
+void mark(swarm::Timestamp, const char* doneName, uint64_t bytes) {
+    uint64_t now = bench::cycles();
+    if (doneName) bench::report(doneName, bytes, now - startCycles);
+    startCycles = now;
+}
+
+} // anonymous namespace
+
+int main() {
+    src = new uint64_t[kElems];
+    dst = new uint64_t[kElems];
+
+    // Phases: fill [0,1), copy [2,3), reduce [4,...); the boundary tasks at
+    // odd timestamps are CANTSPEC so they run once everything before them
+    // committed
+    swarm::enqueueLambda([] (swarm::Timestamp) {
+        mark(0, nullptr, 0);
+        swarm::fill<EnqFlags(NOHINT | MAYSPEC)>(src, src + kElems, 7ul, 0ul);
+    }, 0, EnqFlags::NOHINT);
+
+    swarm::enqueueLambda([] (swarm::Timestamp) {
+        mark(0, "fill", kBytes);
+        swarm::copy<EnqFlags(NOHINT | MAYSPEC)>(src, src + kElems, dst, 2ul);
+    }, 1, EnqFlags(NOHINT | CANTSPEC));
+
+    swarm::enqueueLambda([] (swarm::Timestamp) {
+        mark(0, "copy", 2 * kBytes);  // copy reads and writes every byte
+        swarm::reduce(dst, dst + kElems, 0ul,
+                [] (uint64_t a, uint64_t v) { return a + v; }, 4ul,
+                [] (swarm::Timestamp, uint64_t total) {
+            bench::report("reduce", kBytes, bench::cycles() - startCycles);
+            printf("[BENCH] reduce total %lu\n", total);
+        });
+    }, 3, EnqFlags(NOHINT | CANTSPEC));
+
+    swarm::run();
+    return 0;
+}
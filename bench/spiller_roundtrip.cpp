@@ -0,0 +1,67 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// Spiller/requeuer round-trip cost. Both phases produce and drain the same
+// number of empty tasks; the "near" phase keeps them dequeue-able right
+// away, while the "far" phase parks them at a distant timestamp, so far
+// more tasks are live at once than the task units can hold and the
+// overflow takes the spill-to-memory/requeue round trip (impl/spillers.h).
+// The per-task delta between the two rows is the round-trip cost. Only the
+// Swarm runtime has spillers; under the software runtimes both rows just
+// measure priority-queue throughput.
+
+#include "swarm/api.h"
+#include "swarm/algorithm.h"
+#include "common.h"
+
+namespace {
+
+constexpr uint64_t kTasks = 1ul << 18;
+constexpr uint64_t kFarOffset = 1ul << 20;
+
+uint64_t startCycles;
+
+void payload(swarm::Timestamp) {}
+
+void kickoff(swarm::Timestamp ts, uint64_t offset);
+
+void finish(swarm::Timestamp ts, uint64_t offset) {
+    bench::report(offset > 1 ? "drain far (spilled)" : "drain near",
+                  kTasks, bench::cycles() - startCycles);
+    if (offset == 1)
+        swarm::enqueue(kickoff, ts + 1, EnqFlags::NOHINT, kFarOffset);
+}
+
+void kickoff(swarm::Timestamp ts, uint64_t offset) {
+    startCycles = bench::cycles();
+    swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(
+            swarm::u64it(0ul), swarm::u64it(kTasks),
+            [offset] (swarm::Timestamp ts, uint64_t) {
+        swarm::enqueue(payload, ts + offset, EnqFlags::NOHINT);
+    }, ts);
+    swarm::enqueue(finish, ts + offset + 1, EnqFlags(NOHINT | CANTSPEC),
+                   offset);
+}
+
+} // anonymous namespace
+
+int main() {
+    swarm::enqueue(kickoff, 0, EnqFlags::NOHINT, 1ul);
+    swarm::run();
+    return 0;
+}
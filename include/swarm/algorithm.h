@@ -41,7 +41,8 @@ typedef boost::counting_iterator<int32_t> i32it;
 // is small (<= MaxBaseEnqs), enqueue_all* directly runs all the calls to the
 // enqueue lambda serially.  If the range is large (> MaxBaseEnqs),
 // enqueue_all* spawns enqueuer tasks that may run the calls to the enqueue
-// lambda in parallel.
+// lambda in parallel.  A MaxBaseEnqs of 0, the default, tracks the tree
+// fanout below.
 //
 // The fourth argument to enqueue_all* specifies the timestamp of enqueuers.
 // It may be either an integer timestamp value, or a unary function object that
@@ -50,8 +51,14 @@ typedef boost::counting_iterator<int32_t> i32it;
 // This uses a *complete* n-arry tree of enqueuer tasks.  That is, each
 // enqueuer recursively enqueues n children enqueuers except for in the last
 // level of recursive enqueues, which may not be full.
+//
+// The tree fanout n is derived from the machine at startup (small fanouts
+// underutilize large configurations during the expansion, large fanouts
+// overflow small machines' task queues); pass a power of two as Fanout to
+// pin it for one call, or define PLS_ENQUEUE_ALL_FANOUT to pin it globally.
 template <EnqFlags Flags = EnqFlags::NOHINT,
-          uint32_t MaxBaseEnqs = swarm::max_children,
+          uint32_t MaxBaseEnqs = 0,
+          uint32_t Fanout = 0,
           typename Iterator,
           typename EnqOneFn,
           typename TimestampType>
@@ -68,7 +75,7 @@ static inline void enqueue_all(
 
 // An enqueue_all that uses bounded parallel strands, not a complete tree.
 // It expects a timestamp lambda and hint lambda for __enqueuers
-template <uint32_t MaxBaseEnqs = swarm::max_children,
+template <uint32_t MaxBaseEnqs = 0,
           uint32_t EnqueuesPerTask = 4,
           uint32_t MaxStrands = UINT32_MAX,
           typename Iterator,
@@ -80,7 +87,7 @@ static inline void enqueue_all(Iterator first, Iterator last,
 
 // An enqueue_all variant that starts enqueuing real tasks immediately,
 // and gradually expands into a tree of parallel strands.
-template <uint32_t MaxBaseEnqs = swarm::max_children,
+template <uint32_t MaxBaseEnqs = 0,
           uint32_t EnqueuesPerTask = 4,
           uint32_t MaxStrands = UINT32_MAX,
           typename Iterator,
@@ -90,15 +97,82 @@ template <uint32_t MaxBaseEnqs = swarm::max_children,
 static inline void enqueue_all_progressive(Iterator first, Iterator last,
         EnqueueLambda, TimestampLambda, HintLambda);
 
+// An enqueue_all_progressive over a range whose trip count isn't known up
+// front (e.g. a dynamically growing worklist): applies the enqueue lambda to
+// consecutive elements starting at first while the predicate holds.
+template <uint32_t EnqueuesPerTask = 4,
+          uint32_t MaxStrands = UINT32_MAX,
+          typename Iterator,
+          typename Predicate,
+          typename EnqueueLambda,
+          typename TimestampLambda,
+          typename HintLambda>
+static inline void enqueue_all_while(Iterator first, Predicate pred,
+        EnqueueLambda, TimestampLambda, HintLambda);
 
 
-template <EnqFlags Flags, class InputIt, class OutputIt>
+
+// NonTemporal selects streaming-store block kernels for destinations that
+// won't be re-read before eviction (e.g. multi-GB initialization).
+template <EnqFlags Flags, bool NonTemporal = false, class InputIt, class OutputIt>
 static inline void copy(InputIt first, InputIt last,
                         OutputIt d_first, Timestamp);
 
-template <EnqFlags Flags = EnqFlags::NOHINT, class Iterator, typename T>
+template <EnqFlags Flags = EnqFlags::NOHINT, bool NonTemporal = false,
+          class Iterator, typename T>
 static inline void fill(Iterator first, Iterator last, const T& v, Timestamp);
 
+// A parallel merge sort over a contiguous range of trivially copyable
+// elements. The sort appears atomic at ts, like swarm::reduce: the variant
+// taking a callback enqueues it (in the caller's domain) once the range is
+// sorted.
+template <class Iterator, class Compare, class CallBackLambda>
+static inline void sort(Iterator first, Iterator last, Compare cmp,
+                        Timestamp ts, CallBackLambda cb);
+
+template <class Iterator, class Compare>
+static inline void sort(Iterator first, Iterator last, Compare cmp,
+                        Timestamp ts);
+
+template <class Iterator>
+static inline void sort(Iterator first, Iterator last, Timestamp ts);
+
+// Conditional-min/max write ("priority update"): a task hinted to addr's
+// cache line that overwrites *addr with value only if cmp(value, *addr).
+// A losing update reads and exits with an empty write-set, so it aborts
+// cheaply and same-line readers can commit around it.
+template <typename T, typename Compare>
+static inline void priority_update(T* addr, T value, Compare cmp,
+                                   Timestamp ts);
+
+// Batched variant over a contiguous range of {addr, value} records (e.g.
+// std::pair<T*, T>), which must outlive the updates. Updates to the same
+// cache line within one chunk of the expansion share a single hinted task.
+template <typename Iterator, typename Compare>
+static inline void priority_update_all(Iterator first, Iterator last,
+                                       Compare cmp, Timestamp ts);
+
+// Parallel std::find_if. Scans position-ordered blocks at increasing
+// timestamps; on a hit, the hitting task lowers its timestamp (setGvt)
+// before publishing, so later-timestamped blocks squash and exit instead of
+// scanning. cb is enqueued (in the caller's domain, like swarm::reduce's)
+// with the first matching iterator, or last if nothing matched.
+template <class Iterator, class Predicate, class CallBackLambda>
+static inline void find_if(Iterator first, Iterator last, Predicate pred,
+                           Timestamp ts, CallBackLambda cb);
+
+// Parallel std::min_element; cb receives an iterator to the first minimum
+// (last for an empty range). Every element must be visited, so there is no
+// early exit; blocks update a shared best read-first, keeping non-improving
+// blocks' write-sets empty.
+template <class Iterator, class Compare, class CallBackLambda>
+static inline void min_element(Iterator first, Iterator last, Compare cmp,
+                               Timestamp ts, CallBackLambda cb);
+
+template <class Iterator, class CallBackLambda>
+static inline void min_element(Iterator first, Iterator last, Timestamp ts,
+                               CallBackLambda cb);
+
 
 
 static constexpr uint32_t ilog2(uint64_t i) { return 63 - __builtin_clzl(i); }
@@ -108,3 +182,6 @@ static constexpr uint32_t ilog2(uint64_t i) { return 63 - __builtin_clzl(i); }
 #include "impl/enqueue_all.h"
 #include "impl/copy.h"
 #include "impl/fill.h"
+#include "impl/sort.h"
+#include "impl/priority_update.h"
+#include "impl/find.h"
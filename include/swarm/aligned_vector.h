@@ -0,0 +1,153 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// A dynamic array of cache-line-padded elements, for per-thread/per-tile
+// state that std::vector<swarm::aligned<T>> handles poorly (see the FIXME in
+// aligned.h). Elements are stored in groups of ElemsPerGroup per padded slot
+// (1 by default, i.e. one line per element); raise it for state that is
+// partitioned coarsely enough that a few neighbors can share a line.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <type_traits>
+
+#include "api.h"
+#include "algorithm.h"
+
+namespace swarm {
+
+template <typename T, uint32_t ElemsPerGroup = 1>
+class aligned_vector {
+    static_assert(std::is_trivial<T>::value,
+                  "swarm::aligned_vector elements must be trivial");
+    static_assert(ElemsPerGroup > 0, "groups must hold at least one element");
+
+    struct alignas(SWARM_CACHE_LINE) Group { T elems[ElemsPerGroup]; };
+
+    Group* groups;
+    size_t length;
+
+    // new[] of an over-aligned type trips -Waligned-new pre-C++17, so
+    // allocate raw storage; the elements are trivial anyway
+    static Group* allocate(size_t ngroups) {
+        void* p;
+        if (posix_memalign(&p, alignof(Group), ngroups * sizeof(Group)))
+            std::abort();
+        return static_cast<Group*>(p);
+    }
+
+    static constexpr size_t numGroups(size_t l) {
+        return (l + ElemsPerGroup - 1) / ElemsPerGroup;
+    }
+
+    // Give the stale tail elements of the boundary group (recopied from the
+    // old array by a growing resize) the fill value
+    void stitch(size_t oldLength, const T& v) {
+        size_t end = std::min(length, numGroups(oldLength) * ElemsPerGroup);
+        for (size_t i = oldLength; i < end; i++) (*this)[i] = v;
+    }
+
+  public:
+    aligned_vector() : groups(nullptr), length(0ul) {}
+    explicit aligned_vector(size_t n, const T& v = T())
+            : groups(allocate(numGroups(n))), length(n) {
+        for (size_t i = 0; i < n; i++) (*this)[i] = v;
+    }
+    ~aligned_vector() { free(groups); }
+
+    aligned_vector(const aligned_vector&) = delete;
+    aligned_vector& operator=(const aligned_vector&) = delete;
+
+    aligned_vector(aligned_vector&& other) noexcept
+            : groups(other.groups), length(other.length) {
+        other.groups = nullptr;
+        other.length = 0ul;
+    }
+    aligned_vector& operator=(aligned_vector&& other) noexcept {
+        std::swap(groups, other.groups);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    size_t size() const { return length; }
+
+    T& operator[](size_t i) {
+        return groups[i / ElemsPerGroup].elems[i % ElemsPerGroup];
+    }
+    const T& operator[](size_t i) const {
+        return groups[i / ElemsPerGroup].elems[i % ElemsPerGroup];
+    }
+
+    // The cache-line hint if you intend to read/write element i
+    uint64_t hint(size_t i) const {
+        return swarm::Hint::cacheLine(&groups[i / ElemsPerGroup]);
+    }
+
+    void resize(size_t l, const T& v) {
+        Group* old = groups;
+        const size_t oldLength = length;
+        length = l;
+        groups = allocate(numGroups(l));
+        const size_t common = std::min(oldLength, l);
+        std::copy(old, old + numGroups(common), groups);
+        for (size_t i = common; i < l; i++) (*this)[i] = v;
+        free(old);
+    }
+
+    // Asynchronously resize at the given timestamp, initializing new
+    // elements in parallel as swarm::bitset::resize does. swarm::fill would
+    // pass a whole padded group through task args, so new groups are instead
+    // filled by per-group tasks hinted to their lines.
+    template <EnqFlags Flags = EnqFlags::NOHINT>
+    void resize(size_t l, const T& v, swarm::Timestamp ts) {
+        swarm::enqueueLambda([this, l, v] (swarm::Timestamp) {
+            Group* old = groups;
+            const size_t oldLength = length;
+            length = l;
+            groups = allocate(numGroups(l));
+            Group* ng = groups;
+            const size_t commonGroups = numGroups(std::min(oldLength, l));
+
+            // Copy the preserved groups and fill the new ones at 0, then
+            // stitch the boundary and free the old array at 1
+            swarm::deepen();
+            if (commonGroups)
+                swarm::copy<Flags>(old, old + commonGroups, ng, 0ul);
+            if (numGroups(l) > commonGroups) {
+                swarm::enqueue_all<Flags, swarm::max_children>(
+                        swarm::u64it(commonGroups),
+                        swarm::u64it(numGroups(l)),
+                        [ng, v] (swarm::Timestamp ts, uint64_t g) {
+                    swarm::enqueueLambda([ng, g, v] (swarm::Timestamp) {
+                        std::fill(ng[g].elems,
+                                  ng[g].elems + ElemsPerGroup, v);
+                    }, ts, {swarm::Hint::cacheLine(&ng[g]),
+                            EnqFlags::MAYSPEC});
+                }, 0ul);
+            }
+            swarm::enqueueLambda([this, old, oldLength, v] (swarm::Timestamp) {
+                stitch(oldLength, v);
+                free(old);
+            }, 1ul, Flags);
+        }, ts, Flags);
+    }
+};
+
+}  // end namespace swarm
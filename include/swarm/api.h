@@ -100,7 +100,14 @@ static inline void undeepen();
 /* Lower our own timestamp if we are the GVT task */
 static inline void setGvt(Timestamp ts);
 
-/* Clear the read Set of the current task */
+/* Ask the simulator to place the address range [start, end) in the cache
+ * partition of the given tile. A no-op outside the Swarm simulator.
+ * See partition.h for allocators built on this. */
+static inline void mallocPartition(void* start, void* end, uint64_t partition);
+
+/* Clear the read Set of the current task.
+ * For scoped untracked reads, prefer swarm::read_unwatched or
+ * swarm::load_unwatched (impl/unwatched.h). */
 static inline void clearReadSet();
 
 /* current Task will be recorded as aborted even if it was committed */
@@ -124,11 +131,15 @@ static inline Timestamp superTimestamp();
 #include "impl/tls_runtime.h"
 #elif defined(ORACLE_RUNTIME)
 #include "impl/oracle_runtime.h"
+#elif defined(NATIVE_RUNTIME)
+#include "impl/native_runtime.h"
 #elif defined(SCC_RUNTIME) || defined(SCC_SERIAL_RUNTIME)
 #include "scc/swarm_runtime.h"
 #else
 #error "Need appropriate runtime"
 #endif
 
+#include "impl/unwatched.h"
+
 #undef FROM_PLS_API
 #endif  // PLS_API_H_
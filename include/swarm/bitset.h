@@ -20,11 +20,26 @@
 // Swarm algorithms (e.g. support for spatial hints and parallel fill)
 #pragma once
 
+#include <cassert>
+
 #include "api.h"
 #include "algorithm.h"
+#include "numeric.h"
 
 namespace swarm {
 
+// Word-level update functors for the parallel bulk operations below
+struct __BitOrOp  { void operator()(uint64_t& d, uint64_t s) const { d |= s; } };
+struct __BitAndOp { void operator()(uint64_t& d, uint64_t s) const { d &= s; } };
+struct __BitXorOp { void operator()(uint64_t& d, uint64_t s) const { d ^= s; } };
+
+template <typename WordOp>
+static void __bitsetWordTask(swarm::Timestamp, uint64_t* dst,
+                             const uint64_t* src, uint64_t nwords) {
+    WordOp op;
+    for (uint64_t w = 0; w < nwords; w++) op(dst[w], src[w]);
+}
+
 class bitset {
   public:
     bitset() : length(0ul), blocks(nullptr) {}
@@ -37,6 +52,10 @@ class bitset {
     inline size_t size() const { return length; }
     void resize(size_t l, bool value);
 
+    // Serial whole-word scans with early exit on the first set word
+    inline bool any() const;
+    inline bool none() const { return !any(); }
+
     // Swarm-style interface
 
     // Asynchronously resize the bitset at the given timestamp
@@ -46,9 +65,29 @@ class bitset {
     // The cache-line hint if you intend to read/write bit pos
     inline uint64_t hint(uint64_t pos) const;
 
+    // Count the set bits in parallel (a popcount map-reduce over the words);
+    // cb is enqueued at ts with the count, as with swarm::reduce
+    template <typename CallBack>
+    inline void count(swarm::Timestamp ts, CallBack cb) const;
+
+    // Parallel bulk updates from another bitset of equal size: one task per
+    // cache line of words, spatially hinted like hint(). These must be called
+    // from within a task; the word tasks run at the caller's timestamp.
+    inline bitset& operator|=(const bitset& rhs);
+    inline bitset& operator&=(const bitset& rhs);
+    inline bitset& operator^=(const bitset& rhs);
+
   private:
     inline uint64_t numBlocks() const;
 
+    // Keep bits past length zero (and give bits past the old end the fill
+    // value on a growing resize), so count() and the word-level bulk ops can
+    // work on whole words
+    inline void stitch(uint64_t oldLength, uint64_t mask);
+
+    template <typename WordOp>
+    inline void bulkOp(const bitset& rhs, swarm::Timestamp ts);
+
     uint64_t length;
     uint64_t* blocks;
     static constexpr uint64_t BLOCK_SIZE = 64ul;
@@ -73,34 +112,115 @@ void swarm::bitset::set(uint64_t pos, bool value) {
 
 
 void swarm::bitset::resize(size_t l, bool value) {
-    if (length > 0ul) {
-        swarm::info("Resize of existing data not yet supported");
-        std::abort();
-    }
+    uint64_t* old = blocks;
+    const uint64_t oldNum = old ? numBlocks() : 0ul;
+    const uint64_t oldLength = length;
+    const uint64_t mask = value ? ~(0ul) : 0ul;
     length = l;
-    if (blocks) delete [] blocks;
     blocks = new uint64_t[numBlocks()];
-    uint64_t mask = value ? ~(0ul) : 0ul;
-    std::fill(blocks, blocks + numBlocks(), mask);
+    const uint64_t common = std::min(oldNum, numBlocks());
+    std::copy(old, old + common, blocks);
+    std::fill(blocks + common, blocks + numBlocks(), mask);
+    stitch(oldLength, mask);
+    delete [] old;
 }
 
 
 template <EnqFlags Flags>
 void swarm::bitset::resize(size_t l, bool value, swarm::Timestamp ts) {
     uint64_t mask = value ? ~(0ul) : 0ul;
-    swarm::enqueueLambda([this, l, mask] (swarm::Timestamp ts) {
-        if (length > 0ul) {
-            swarm::info("Resize of existing data not yet supported");
-            std::abort();
-        }
+    swarm::enqueueLambda([this, l, mask] (swarm::Timestamp) {
+        uint64_t* old = blocks;
+        const uint64_t oldNum = old ? numBlocks() : 0ul;
+        const uint64_t oldLength = length;
         length = l;
-        if (blocks) delete [] blocks;
-        blocks = new uint64_t[numBlocks()];
-        swarm::fill<Flags>(blocks, blocks + numBlocks(), mask, ts);
+        const uint64_t newNum = numBlocks();
+        blocks = new uint64_t[newNum];
+        const uint64_t common = std::min(oldNum, newNum);
+
+        // Copy the preserved words and fill the new ones at 0, then stitch
+        // the boundary and free the old array at 1, once those committed
+        swarm::deepen();
+        if (common)
+            swarm::copy<Flags>(old, old + common, blocks, 0ul);
+        if (newNum > common)
+            swarm::fill<Flags>(blocks + common, blocks + newNum, mask, 0ul);
+        swarm::enqueueLambda([this, old, oldLength, mask] (swarm::Timestamp) {
+            stitch(oldLength, mask);
+            delete [] old;
+        }, 1ul, Flags);
     }, ts, Flags);
 }
 
 
+void swarm::bitset::stitch(uint64_t oldLength, uint64_t mask) {
+    if (length > oldLength && (oldLength % BLOCK_SIZE)) {
+        uint64_t low = (1ul << (oldLength % BLOCK_SIZE)) - 1ul;
+        uint64_t w = oldLength / BLOCK_SIZE;
+        blocks[w] = (blocks[w] & low) | (mask & ~low);
+    }
+    uint64_t rem = length % BLOCK_SIZE;
+    if (rem) blocks[numBlocks() - 1] &= (1ul << rem) - 1ul;
+}
+
+
+bool swarm::bitset::any() const {
+    const uint64_t* end = blocks + numBlocks();
+    for (const uint64_t* b = blocks; b != end; b++)
+        if (*b) return true;
+    return false;
+}
+
+
+template <typename CallBack>
+void swarm::bitset::count(swarm::Timestamp ts, CallBack cb) const {
+    auto o = [] (uint64_t acc, uint64_t word) {
+        return acc + static_cast<uint64_t>(__builtin_popcountll(word));
+    };
+    auto c = [] (uint64_t acc, uint64_t partial) { return acc + partial; };
+    swarm::reduce(blocks, blocks + numBlocks(), 0ul, o, c, ts, cb);
+}
+
+
+template <typename WordOp>
+void swarm::bitset::bulkOp(const bitset& rhs, swarm::Timestamp ts) {
+    assert(length == rhs.length);
+    uint64_t* dst = blocks;
+    const uint64_t* src = rhs.blocks;
+    const uint64_t words = numBlocks();
+    constexpr uint64_t wpl = swarm::block::elementsPerLine<uint64_t*>();
+    const uint64_t lines = (words + wpl - 1) / wpl;
+    swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), swarm::max_children>(
+            swarm::u64it(0ul), swarm::u64it(lines),
+            [dst, src, words] (swarm::Timestamp ts, uint64_t line) {
+        constexpr uint64_t wpl = swarm::block::elementsPerLine<uint64_t*>();
+        uint64_t begin = line * wpl;
+        uint64_t n = std::min(wpl, words - begin);
+        swarm::enqueue((__bitsetWordTask<WordOp>), ts,
+                     {swarm::Hint::cacheLine(dst + begin), EnqFlags::MAYSPEC},
+                     dst + begin, src + begin, n);
+    }, ts);
+}
+
+
+swarm::bitset& swarm::bitset::operator|=(const bitset& rhs) {
+    bulkOp<swarm::__BitOrOp>(rhs, swarm::timestamp());
+    return *this;
+}
+
+
+swarm::bitset& swarm::bitset::operator&=(const bitset& rhs) {
+    bulkOp<swarm::__BitAndOp>(rhs, swarm::timestamp());
+    return *this;
+}
+
+
+swarm::bitset& swarm::bitset::operator^=(const bitset& rhs) {
+    bulkOp<swarm::__BitXorOp>(rhs, swarm::timestamp());
+    return *this;
+}
+
+
 uint64_t swarm::bitset::hint(uint64_t pos) const {
     uint64_t block = pos / BLOCK_SIZE;
     return swarm::Hint::cacheLine(&blocks[block]);
@@ -19,11 +19,13 @@
 #pragma once
 
 #include <stdint.h>
-#include <atomic>
-#include <array>
+#include <cstdlib>
+#include <functional>
+#include <new>
 
 #include "aligned.h"
 #include "api.h"
+#include "numeric.h"
 
 namespace swarm {
 
@@ -37,7 +39,18 @@ void __increment(Timestamp ts, ParallelCounter<T>* pc, uint64_t val) {
 template<typename T>
 class alignas(SWARM_CACHE_LINE) ParallelCounter {
 public:
+    ParallelCounter() : lcs_(nullptr) {}
+    ParallelCounter(const ParallelCounter&) = delete;
+    ParallelCounter& operator=(const ParallelCounter&) = delete;
+    ~ParallelCounter() { std::free(lcs_); }
+
     ParallelCounter & operator+=(const T & rhs) {
+        // Allocate lazily on first increment, sized by the actual thread
+        // count: apps keep dozens of counters and most see few increments,
+        // so embedding storage for 2048 threads (128KB each) wasted cache
+        // and tracked footprint. Concurrent first increments race on lcs_,
+        // which speculation resolves like any other conflict.
+        if (pls_unlikely(!lcs_)) lcs_ = allocLocalCounters();
         lcs_[swarm::tid()] += rhs;
         return *this;
     }
@@ -53,16 +66,34 @@ public:
         swarm::enqueue(swarm::__increment<T>, ts, EnqFlags::NOHINT, this, val);
     }
 
-    T reduce() const {
-        // Not thread-safe
-        T accumulator = 0;
-        for (auto & lc : lcs_) accumulator += lc;
-        return accumulator;
+    /* Parallel tree reduction over the per-thread counters (see
+     * impl/reduce.h). As with swarm::reduce, cb is enqueued at ts with the
+     * total as its argument; deepen() first if the callback must appear
+     * atomic with the reduction. */
+    template <typename CallBack>
+    void reduce(Timestamp ts, CallBack cb) const {
+        if (!lcs_) {
+            // Never incremented
+            swarm::enqueueLambda(cb, ts, EnqFlags::NOHINT, T());
+        } else {
+            swarm::reduce(lcs_, lcs_ + swarm::num_threads(), T(),
+                          std::plus<T>(), ts, cb);
+        }
     }
 
 private:
     using LocalCounter = swarm::aligned<T>;
-    std::array<LocalCounter, 2048> lcs_;
+    LocalCounter* lcs_;
+
+    static LocalCounter* allocLocalCounters() {
+        uint32_t n = swarm::num_threads();
+        void* mem;
+        if (posix_memalign(&mem, SWARM_CACHE_LINE, n * sizeof(LocalCounter)))
+            std::abort();
+        auto* lcs = static_cast<LocalCounter*>(mem);
+        for (uint32_t i = 0; i < n; i++) new (&lcs[i]) LocalCounter();
+        return lcs;
+    }
 };
 
 } // end namespace swarm
@@ -23,6 +23,8 @@
 
 #include <boost/iterator/counting_iterator.hpp>
 #include <algorithm>
+#include <tuple>
+#include <type_traits>
 #include "api.h"
 #include "algorithm.h"
 
@@ -45,13 +47,23 @@ namespace swarm {
 template <typename IterType, typename HintLambda,
           typename BodyLambda, typename TermLambda>
 struct __ForallLoopData {
-    volatile IterType strandsFinished;
-    char padding[SWARM_CACHE_LINE - sizeof(strandsFinished)];
     const HintLambda hl;
     const BodyLambda bl;
+    const IterType first;
     const IterType sup;
     const IterType stride;
+    const uint32_t ntiles;  // min(stride, numTiles())
     const TermLambda tl;
+    volatile uint32_t tilesDone;
+    char padding[SWARM_CACHE_LINE - sizeof(tilesDone)];
+    struct alignas(SWARM_CACHE_LINE) TileCount { volatile IterType count; };
+    TileCount strandsFinished[0];  // one counter per tile
+
+    // Strands are dealt round-robin to tiles, so tiles with
+    // t < stride % ntiles serve one extra strand
+    inline IterType tileShare(uint32_t t) const {
+        return stride / ntiles + (t < stride % ntiles);
+    }
 
     inline void operator()(swarm::Timestamp ts, IterType i) {
         bl(ts, i);
@@ -62,17 +74,28 @@ struct __ForallLoopData {
                                {h.hint, EnqFlags(h.flags | SAMETASK)},
                                next);
         } else {
-            pls_cbegin(ts,
-                       Hint(Hint::cacheLine(&strandsFinished),
-                            EnqFlags::MAYSPEC),
-                       [this]);
-            IterType last = __sync_add_and_fetch(&strandsFinished, 1);
-            if (last == stride) {
-                // We don't know what data the termination lambda accesses,
-                // so we can't wrap it in a MAYSPEC task
-                pls_cbegin(ts, EnqFlags::NOHINT, [this]);
-                tl(ts);
-                delete this;
+            // Count each strand out on its own tile's counter, instead of
+            // ping-ponging one shared cache line across all tiles; only the
+            // last strand of each tile touches the shared tilesDone line, so
+            // it sees ntiles writes rather than stride
+            const uint32_t t =
+                    static_cast<uint32_t>((i - first) % stride) % ntiles;
+            pls_cbegin(ts, Hint(t, EnqFlags(NOHASH | MAYSPEC)), [this, t]);
+            IterType done = __sync_add_and_fetch(&strandsFinished[t].count, 1);
+            if (done == tileShare(t)) {
+                pls_cbegin(ts,
+                           Hint(Hint::cacheLine(&tilesDone),
+                                EnqFlags::MAYSPEC),
+                           [this]);
+                uint32_t full = __sync_add_and_fetch(&tilesDone, 1);
+                if (full == ntiles) {
+                    // We don't know what data the termination lambda
+                    // accesses, so we can't wrap it in a MAYSPEC task
+                    pls_cbegin(ts, EnqFlags::NOHINT, [this]);
+                    tl(ts);
+                    free(this);
+                    pls_cend();
+                }
                 pls_cend();
             }
             pls_cend();
@@ -81,22 +104,30 @@ struct __ForallLoopData {
 };
 
 
+// maxStrands is tunable (0 means auto). The default scales the strand count
+// with the loop length, as in forall_ts: short loops are likely inner loops,
+// where a few strands limit control and termination overheads, while long
+// loops still get a strand per hardware context and then some.
 template <typename IterType, typename HintLambda,
           typename BodyLambda, typename TermLambda>
 inline void forall(swarm::Timestamp ts, IterType first, IterType sup,
-                   HintLambda hl, BodyLambda bl, TermLambda tl) {
+                   HintLambda hl, BodyLambda bl, TermLambda tl,
+                   uint32_t maxStrands = 0) {
     assert(sup >= first);
     if (sup == first) {
         tl(ts);
         return;
     }
 
-    // TODO(dsm): Allow setting number of strands? (this prioritizes
-    // parallelism, but may incur excessive control overheads with short loops)
-    uint32_t stride = std::min(sup - first, (IterType) num_threads()*4);
+    if (maxStrands == 0) maxStrands = num_threads() * 4;
+    uint32_t stride = std::min((sup - first)/4 + 1, (IterType) maxStrands);
+    uint32_t ntiles = std::min(stride, swarm::numTiles());
 
     using LD = __ForallLoopData<IterType, HintLambda, BodyLambda, TermLambda>;
-    auto* l = new LD{0, {}, hl, bl, sup, (IterType)stride, tl};
+    void* mem = malloc(sizeof(LD) + ntiles * sizeof(typename LD::TileCount));
+    auto* l = new (mem) LD{hl, bl, first, sup, (IterType)stride, ntiles, tl,
+                           0, {}};
+    for (uint32_t t = 0; t < ntiles; t++) l->strandsFinished[t].count = 0;
 
     swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(
                      boost::counting_iterator<uint32_t>(0),
@@ -566,3 +597,108 @@ inline void getcc(BodyLambda bl, TermLambda tl) {
             }); \
 }
 
+/* task_chain - staged continuations sharing one frame
+ *
+ * Nested pls_cbegin/pls_cend chains pay an enqueue plus a closure copy per
+ * stage, with each capture list re-copying the whole context. A task_chain
+ * instead declares its stages up front, allocates the shared state and all
+ * stage lambdas in a single frame, and threads a frame pointer through the
+ * stages. Consecutive stages whose timestamp and hint don't change are fused:
+ * the running task already holds that timestamp and hint, so the next stage
+ * runs in it directly, and only a real timestamp or hint change enqueues.
+ *
+ *   struct S { uint64_t key; Node* n; };
+ *   swarm::task_chain(S{key, nullptr})
+ *       .then(0, [] (const S& s) { return swarm::Hint(s.key); },
+ *                [] (swarm::Timestamp ts, S& s) { s.n = lookup(s.key); })
+ *       .then(1, [] (const S& s) { return swarm::Hint::cacheLine(s.n); },
+ *                [] (swarm::Timestamp ts, S& s) { update(s.n); })
+ *       .run(ts);
+ *
+ * Stage timestamps are deltas from the previous stage; hint lambdas take the
+ * state so later stages can be hinted by data computed in earlier ones. The
+ * frame is freed when the last stage finishes.
+ */
+namespace swarm {
+
+template <typename HintLambda, typename BodyLambda>
+struct __ChainStage {
+    const uint64_t tsDelta;
+    const HintLambda hl;
+    const BodyLambda bl;
+};
+
+template <typename State, typename... Stages>
+struct __TaskChainFrame {
+    State state;
+    const std::tuple<Stages...> stages;
+    // The hint of the task currently running the chain, to detect fusable
+    // stages; only one task runs a chain at a time, so no synchronization
+    uint64_t curHint;
+    uint64_t curFlags;
+
+    template <size_t I>
+    inline void runStage(swarm::Timestamp ts) {
+        std::get<I>(stages).bl(ts, state);
+        advance<I + 1>(ts);
+    }
+
+    template <size_t I>
+    inline typename std::enable_if<I == sizeof...(Stages), void>::type
+    advance(swarm::Timestamp) {
+        delete this;
+    }
+
+    template <size_t I>
+    inline typename std::enable_if<(I < sizeof...(Stages)), void>::type
+    advance(swarm::Timestamp ts) {
+        const auto& stage = std::get<I>(stages);
+        swarm::Timestamp nextTs = ts + stage.tsDelta;
+        swarm::Hint h(stage.hl(state));
+        if (nextTs == ts && h.hint == curHint &&
+                static_cast<uint64_t>(h.flags) == curFlags) {
+            // Fused: this task already holds the stage's timestamp and hint
+            runStage<I>(ts);
+        } else {
+            curHint = h.hint;
+            curFlags = static_cast<uint64_t>(h.flags);
+            swarm::enqueueLambda([] (swarm::Timestamp ts,
+                                     __TaskChainFrame* frame) {
+                frame->template runStage<I>(ts);
+            }, nextTs, h, this);
+        }
+    }
+};
+
+template <typename State, typename... Stages>
+struct __TaskChain {
+    const State state;
+    const std::tuple<Stages...> stages;
+
+    // Append a stage running at the previous stage's ts + tsDelta, hinted by
+    // hl(state)
+    template <typename HL, typename BL>
+    inline __TaskChain<State, Stages..., __ChainStage<HL, BL>>
+    then(uint64_t tsDelta, HL hl, BL bl) const {
+        return {state, std::tuple_cat(stages,
+                std::make_tuple(__ChainStage<HL, BL>{tsDelta, hl, bl}))};
+    }
+
+    // Allocate the frame (one allocation for the whole chain) and kick off
+    inline void run(swarm::Timestamp ts) const {
+        static_assert(sizeof...(Stages) > 0, "task_chain with no stages");
+        auto* frame = new __TaskChainFrame<State, Stages...>{
+                state, stages, ~0ul, ~0ul};  // sentinel hint: no flag
+                                             // combination matches ~0ul, so
+                                             // the first stage never fuses
+        frame->template advance<0>(ts);
+    }
+};
+
+template <typename State>
+inline __TaskChain<State> task_chain(State state) {
+    return {state, std::tuple<>()};
+}
+
+}  // namespace swarm
+
@@ -0,0 +1,255 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// A pared-down hash map that is friendlier to Swarm algorithms than ad-hoc
+// open-addressed tables (e.g. support for spatial hints, asynchronous resize,
+// and parallel bulk insert), in the spirit of swarm::bitset
+#pragma once
+
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+
+#include "api.h"
+#include "algorithm.h"
+#include "numeric.h"
+#include "rand.h"
+
+namespace swarm {
+
+template <typename K, typename V, typename Hash = std::hash<K> >
+class hashmap {
+    static_assert(std::is_trivially_copyable<K>::value &&
+                  std::is_trivially_copyable<V>::value,
+                  "swarm::hashmap entries must be trivially copyable");
+
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    // Cache-line-sized buckets, so all tasks touching a bucket contend on
+    // exactly one line. Oversized entries degrade to multi-line buckets.
+    struct alignas(SWARM_CACHE_LINE) Bucket {
+        uint64_t n;
+        Entry slots[(SWARM_CACHE_LINE - sizeof(uint64_t)) / sizeof(Entry) > 0 ?
+                    (SWARM_CACHE_LINE - sizeof(uint64_t)) / sizeof(Entry) : 1];
+    };
+    static constexpr uint64_t SLOTS = sizeof(((Bucket*)nullptr)->slots)
+                                      / sizeof(Entry);
+
+  public:
+    hashmap() : nbuckets(0ul), buckets(nullptr) {}
+    explicit hashmap(uint64_t minBuckets)
+        : nbuckets(roundUp(minBuckets)), buckets(allocBuckets(nbuckets)) {}
+    ~hashmap() { if (buckets) free(buckets); }
+
+    // Serial interface
+
+    // Insert without overwriting; returns false if key was already present.
+    // A full probe into the home bucket's neighbors asserts when the whole
+    // table is full: the caller is responsible for resizing in time.
+    inline bool insert(const K& key, const V& value);
+    inline V* find(const K& key);
+    inline const V* find(const K& key) const;
+    inline bool contains(const K& key) const { return find(key) != nullptr; }
+    inline void resize(uint64_t minBuckets);
+    // TODO: erase; open-addressed deletion needs tombstones to preserve
+    // probe chains, and our workloads so far only insert and look up
+
+    // Swarm-style interface
+
+    // The cache-line hint if you intend to operate on key: tasks touching
+    // the same bucket then serialize on its home tile instead of aborting
+    // each other. (An overfull bucket's entries spill to neighboring lines,
+    // so those accesses can still conflict; resize before that happens.)
+    inline uint64_t hint(const K& key) const {
+        return swarm::Hint::cacheLine(&buckets[bucketIdx(key)]);
+    }
+
+    // Asynchronously rehash into at least minBuckets buckets at the given
+    // timestamp, like bitset::resize: the new buckets are cleared and the
+    // old ones rehashed in parallel
+    template <EnqFlags Flags = EnqFlags::NOHINT>
+    void resize(uint64_t minBuckets, swarm::Timestamp ts);
+
+    // Insert [first, last) (pairs or Entry-like, with .first and .second)
+    // in parallel: one task per element, hinted to the element's bucket
+    template <typename Iterator>
+    inline void insert_all(Iterator first, Iterator last, swarm::Timestamp ts);
+
+    // Count the elements in parallel (a reduce over the bucket sizes);
+    // cb is enqueued at ts with the count, as with swarm::reduce
+    template <typename CallBack>
+    inline void size(swarm::Timestamp ts, CallBack cb) const;
+
+  private:
+    inline uint64_t bucketIdx(const K& key) const {
+        // std::hash is the identity for integers, so spread it out
+        return __prngMix(Hash()(key)) & (nbuckets - 1ul);
+    }
+
+    static inline uint64_t roundUp(uint64_t minBuckets) {
+        uint64_t n = 1ul;
+        while (n < minBuckets) n <<= 1;
+        return n;
+    }
+
+    static inline Bucket* allocBuckets(uint64_t n) {
+        void* mem;
+        if (posix_memalign(&mem, SWARM_CACHE_LINE, n * sizeof(Bucket)))
+            std::abort();
+        return static_cast<Bucket*>(mem);
+    }
+
+    inline void rehashBucket(const Bucket* b);
+
+    static void insertTask(swarm::Timestamp, hashmap* m, K key, V value) {
+        m->insert(key, value);
+    }
+
+    static void clearTask(swarm::Timestamp, Bucket* b, uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) b[i].n = 0ul;
+    }
+
+    uint64_t nbuckets;
+    Bucket* buckets;
+};
+
+} // end namespace swarm
+
+
+template <typename K, typename V, typename Hash>
+bool swarm::hashmap<K, V, Hash>::insert(const K& key, const V& value) {
+    const uint64_t home = bucketIdx(key);
+    for (uint64_t i = 0; i < nbuckets; i++) {
+        Bucket* b = &buckets[(home + i) & (nbuckets - 1ul)];
+        for (uint64_t s = 0; s < b->n; s++)
+            if (b->slots[s].key == key) return false;
+        if (b->n < SLOTS) {
+            b->slots[b->n] = {key, value};
+            b->n++;
+            return true;
+        }
+        // Full bucket: the key may still live in (or go to) a neighbor
+    }
+    assert(false);  // table is full; the caller should have resized
+    return false;
+}
+
+
+template <typename K, typename V, typename Hash>
+V* swarm::hashmap<K, V, Hash>::find(const K& key) {
+    const uint64_t home = bucketIdx(key);
+    for (uint64_t i = 0; i < nbuckets; i++) {
+        Bucket* b = &buckets[(home + i) & (nbuckets - 1ul)];
+        for (uint64_t s = 0; s < b->n; s++)
+            if (b->slots[s].key == key) return &b->slots[s].value;
+        if (b->n < SLOTS) return nullptr;  // a probe never skips a non-full bucket
+    }
+    return nullptr;
+}
+
+
+template <typename K, typename V, typename Hash>
+const V* swarm::hashmap<K, V, Hash>::find(const K& key) const {
+    return const_cast<hashmap*>(this)->find(key);
+}
+
+
+template <typename K, typename V, typename Hash>
+void swarm::hashmap<K, V, Hash>::rehashBucket(const Bucket* b) {
+    for (uint64_t s = 0; s < b->n; s++) insert(b->slots[s].key, b->slots[s].value);
+}
+
+
+template <typename K, typename V, typename Hash>
+void swarm::hashmap<K, V, Hash>::resize(uint64_t minBuckets) {
+    Bucket* old = buckets;
+    const uint64_t oldNum = old ? nbuckets : 0ul;
+    nbuckets = roundUp(minBuckets);
+    buckets = allocBuckets(nbuckets);
+    for (uint64_t i = 0; i < nbuckets; i++) buckets[i].n = 0ul;
+    for (uint64_t i = 0; i < oldNum; i++) rehashBucket(&old[i]);
+    free(old);
+}
+
+
+template <typename K, typename V, typename Hash>
+template <EnqFlags Flags>
+void swarm::hashmap<K, V, Hash>::resize(uint64_t minBuckets,
+                                        swarm::Timestamp ts) {
+    swarm::enqueueLambda([this, minBuckets] (swarm::Timestamp) {
+        Bucket* old = buckets;
+        const uint64_t oldNum = old ? nbuckets : 0ul;
+        nbuckets = roundUp(minBuckets);
+        buckets = allocBuckets(nbuckets);
+
+        // Clear the new buckets at 0, rehash the old ones at 1 (each old
+        // bucket's entries re-enqueue hinted to their new home), and free
+        // the old array at 2, once the rehash committed
+        swarm::deepen();
+        const uint64_t groups = (nbuckets + 7ul) / 8ul;
+        swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(
+                swarm::u64it(0ul), swarm::u64it(groups),
+                [this] (swarm::Timestamp ts, uint64_t g) {
+            uint64_t begin = g * 8ul;  // 8 bucket lines cleared per task
+            uint64_t n = std::min(8ul, nbuckets - begin);
+            swarm::enqueue(clearTask, ts,
+                    {swarm::Hint::cacheLine(buckets + begin),
+                     EnqFlags::MAYSPEC},
+                    buckets + begin, n);
+        }, 0ul);
+        swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(
+                swarm::u64it(0ul), swarm::u64it(oldNum),
+                [this, old] (swarm::Timestamp ts, uint64_t i) {
+            const Bucket* b = &old[i];
+            swarm::enqueueLambda([this, b] (swarm::Timestamp ts) {
+                for (uint64_t s = 0; s < b->n; s++) {
+                    swarm::enqueue(insertTask, ts,
+                            {hint(b->slots[s].key), EnqFlags::MAYSPEC},
+                            this, b->slots[s].key, b->slots[s].value);
+                }
+            }, ts, {swarm::Hint::cacheLine(b), EnqFlags::MAYSPEC});
+        }, 1ul);
+        swarm::enqueueLambda([old] (swarm::Timestamp) { free(old); },
+                             2ul, Flags);
+    }, ts, Flags);
+}
+
+
+template <typename K, typename V, typename Hash>
+template <typename Iterator>
+void swarm::hashmap<K, V, Hash>::insert_all(Iterator first, Iterator last,
+                                            swarm::Timestamp ts) {
+    swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(first, last,
+            [this] (swarm::Timestamp ts,
+                    typename std::iterator_traits<Iterator>::reference e) {
+        swarm::enqueue(insertTask, ts, {hint(e.first), EnqFlags::MAYSPEC},
+                     this, e.first, e.second);
+    }, ts);
+}
+
+
+template <typename K, typename V, typename Hash>
+template <typename CallBack>
+void swarm::hashmap<K, V, Hash>::size(swarm::Timestamp ts, CallBack cb) const {
+    auto o = [] (uint64_t acc, const Bucket& b) { return acc + b.n; };
+    auto c = [] (uint64_t acc, uint64_t partial) { return acc + partial; };
+    swarm::reduce(buckets, buckets + nbuckets, 0ul, o, c, ts, cb);
+}
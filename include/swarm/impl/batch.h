@@ -0,0 +1,192 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Batched task enqueues. Every ordinary enqueue traps into the simulator with
+ * one magic op, which dominates the instruction count of enqueue-heavy tasks
+ * (e.g. the enqueuer trees of enqueue_all.h). A TaskBatch instead records
+ * tasks into a TaskDescriptors buffer with plain stores -- the same layout
+ * that spillers use -- and submits the whole batch with a single enqueue of a
+ * requeuer task, which later unpacks the descriptors exactly as when
+ * refilling spilled tasks.
+ *
+ * Trade-off: the batched tasks take an extra dequeue (the requeuer's) before
+ * they exist in hardware queues, so batching pays off for wide fanouts, not
+ * for a task that enqueues one or two children.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include "../api.h"
+
+namespace swarm {
+
+// Whether tasks enqueued with these flags can be recorded in a descriptor
+static constexpr bool __batchableFlags(EnqFlags flags) {
+    return 0ul == (flags & ~(EnqFlags::NOHINT | EnqFlags::SAMETASK |
+                             EnqFlags(0x0ffff)));
+}
+
+// Descriptors, requeuers, and the raw enqueue helpers only exist on the
+// hardware runtime (via hwmisc.h/spillers.h); elsewhere enqueues don't trap,
+// so TaskBatch degenerates to plain enqueues.
+#ifdef SWARM_RUNTIME
+
+// Descriptors only preserve the low 16 flag bits, so a NOHINT task must be
+// assigned a hint before being recorded. Mimic the hardware, which assigns
+// NOHINT tasks a hint drawn uniformly at random: hash the descriptor slot and
+// timestamp (MurmurHash3 finalizer), so there is no shared PRNG state for
+// speculative tasks to conflict on.
+static inline uint64_t __batchHint(const TaskDescriptor* td) {
+    uint64_t x = reinterpret_cast<uintptr_t>(td) ^ (td->ts << 32);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdul;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ul;
+    x ^= x >> 33;
+    return x;
+}
+
+// Record one task into a descriptor, mirroring the runner selection of
+// __enqueueHwTask (see hwtasks.h). Requeuers always replay descriptors with
+// PLS_APP_MAX_ARGS register args, so unused arg slots are left untouched.
+template <typename F, F* f, typename... Args>
+static inline void __describeHwTask(TaskDescriptor* td, Timestamp ts,
+                                    Hint hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+
+    // Relative flags (SAMEHINT, SAMETASK, SAMETIME) and domain flags are
+    // meaningful only at the original enqueue site; a descriptor replayed by
+    // a requeuer can't honor them. NOHINT is resolved below.
+    assert(0ul == (hint.flags & ~(EnqFlags::NOHINT | EnqFlags(0x0ffff))));
+
+    td->ts = ts;
+
+    constexpr size_t targs = (sizeof(std::tuple<Args...>)-1)/8 + 1;
+    static_assert(targs != 0, "");
+    static_assert(targs <= PLS_APP_MAX_ARGS || targs > SIM_MAX_ENQUEUE_REGS,
+        "The app's task argument list exceeds PLS_APP_MAX_ARGS");
+
+    uintptr_t fp;
+    if (targs <= SIM_MAX_ENQUEUE_REGS && targs <= PLS_APP_MAX_ARGS) {
+        union U {
+            uint64_t tp[targs];
+            std::tuple<Args...> tup;
+            U(std::tuple<Args...> t) : tup(t) {}
+        };
+        U u(std::make_tuple(args...));
+        fp = reinterpret_cast<uintptr_t>(regTupleRunner<F, f, Args...>);
+        for (size_t i = 0; i < targs; i++) td->args[i] = u.tp[i];
+    } else {
+        // memTupleRunner frees slot-sized tuples through the arena, so the
+        // allocation here must match (see hwtasks.h)
+        std::tuple<Args...>* tup;
+        if (sizeof(std::tuple<Args...>) <= __tupleSlotBytes)
+            tup = new (__tupleSlotAlloc()) std::tuple<Args...>(args...);
+        else
+            tup = new std::tuple<Args...>(args...);
+        fp = reinterpret_cast<uintptr_t>(memTupleRunner<F, f, Args...>);
+        td->args[0] = reinterpret_cast<uintptr_t>(tup);
+    }
+
+    EnqFlags ef = hint.flags;
+    if (ef & EnqFlags::NOHINT) {
+        td->hint = __batchHint(td);
+        ef = EnqFlags(ef & ~NOHINT);
+    } else {
+        td->hint = hint.hint;
+    }
+    td->taskPtrAndFlags =
+            (static_cast<uint64_t>(fp) << 16) | static_cast<uint64_t>(ef);
+}
+
+/* Collects up to N tasks and submits them with a single magic op.
+ *
+ * Use through the enqueue_batch macro below, e.g.:
+ *    swarm::TaskBatch<swarm::max_children> batch;
+ *    for (...) enqueue_batch(batch, someTask, ts, hint, args...);
+ *    batch.flush();
+ */
+template <uint32_t N>
+class TaskBatch {
+    TaskDescriptors* descs;
+    Timestamp minTs;
+
+  public:
+    TaskBatch() : descs(nullptr), minTs(UINT64_MAX) {}
+    TaskBatch(const TaskBatch&) = delete;
+    ~TaskBatch() { flush(); }
+
+    template <typename F, F* f, typename... Args>
+    inline void add(Timestamp ts, Hint hint, Args... args) {
+        if (!descs) {
+            // The requeuer releases this with sim_zero_cycle_free, so the
+            // allocation must match (see requeuer_impl in spillers.h)
+            descs = static_cast<TaskDescriptors*>(
+                    sim_zero_cycle_untracked_malloc(
+                        sizeof(TaskDescriptors) + N * sizeof(TaskDescriptor)));
+            descs->size = 0;
+            descs->capacity = N;
+        }
+        // SAMETASK just avoids re-sending the task pointer; descriptors
+        // always record the full pointer, so drop it.
+        Hint h = {hint.hint, EnqFlags(hint.flags & ~SAMETASK)};
+        __describeHwTask<F, f, Args...>(&descs->tds[descs->size++],
+                                        ts, h, args...);
+        if (ts < minTs) minTs = ts;
+        if (descs->size == N) flush();
+    }
+
+    inline void flush() {
+        if (!descs) return;
+        // Same flags spillers give their requeuers, minus the
+        // non-timestamped special cases (batched tasks are timestamped)
+        swarm::enqueue(swarm::requeuer, minTs,
+                     EnqFlags(SAMEHINT | NONSERIALHINT | NOHASH |
+                              PRODUCER | REQUEUER),
+                     descs);
+        descs = nullptr;
+        minTs = UINT64_MAX;
+    }
+};
+
+#else  // !SWARM_RUNTIME
+
+template <uint32_t N>
+class TaskBatch {
+  public:
+    template <typename F, F* f, typename... Args>
+    inline void add(Timestamp ts, Hint hint, Args... args) {
+        swarm::enqueueTask<F, f, Args...>(ts, hint, args...);
+    }
+
+    inline void flush() {}
+};
+
+#endif
+
+#define enqueue_batch(batch, f, ...) \
+    (batch).add<std::remove_reference_t<decltype(f)>, f>(__VA_ARGS__)
+
+} // end namespace swarm
@@ -59,6 +59,15 @@ inline void callFuncTupleIgnoringFirstArg(F f, Tuple tup) {
     callFuncTupleImpl(f, tup, typename gent<std::tuple_size<Tuple>::value>::type());
 }
 
+/* Version without the first two arguments */
+template<int N, int... S> struct genu : genu<N-1, N-1, S...> {};
+template<int...S> struct genu<2, S...>{ typedef seq<S...> type; };
+
+template<typename F, typename Tuple>
+inline void callFuncTupleIgnoringFirst2Args(F f, Tuple tup) {
+    callFuncTupleImpl(f, tup, typename genu<std::tuple_size<Tuple>::value>::type());
+}
+
 /* Version for lambda enqueues */
 template<typename L, typename FirstArg, typename... Args>
 inline void callLambdaFunc(FirstArg ts, L lfunc, Args... args) {
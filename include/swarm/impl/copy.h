@@ -18,13 +18,43 @@
 
 #include <cstdint>
 #include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "../api.h"
 #include "block.h"
 
 namespace swarm {
 
 
-template <uint8_t LinesPerGrain, EnqFlags Flags>
+#ifdef __SSE2__
+// memcpy with non-temporal 16-byte stores on the aligned middle of the
+// destination, so huge copies don't evict the working set.
+static inline void __ntCopy(char* __restrict dest,
+                            const char* __restrict source, size_t bytes) {
+    char* d = dest;
+    const char* s = source;
+    char* end = dest + bytes;
+
+    size_t head = std::min<size_t>(
+            (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15, bytes);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    while (d + 16 <= end) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+        d += 16;
+        s += 16;
+    }
+    std::memcpy(d, s, end - d);
+    // Streaming stores are weakly ordered; fence before this task finishes so
+    // consumer tasks observe the copy.
+    _mm_sfence();
+}
+#endif
+
+template <uint8_t LinesPerGrain, EnqFlags Flags, bool NonTemporal>
 static inline void __copier(Timestamp ts,
                             char* __restrict dest,
                             const char* __restrict source,
@@ -35,6 +65,12 @@ static inline void __copier(Timestamp ts,
         return;
     } else if (swarm::block::sameGrain<LinesPerGrain>(dest, dest + bytes)) {
         // Base-case: the destination is a single grain.  Copy serially.
+#ifdef __SSE2__
+        if (NonTemporal) {
+            __ntCopy(dest, source, bytes);
+            return;
+        }
+#endif
         std::memcpy(dest, source, bytes);
     } else {
         char* d_midpoint = dest + bytes / 2;
@@ -59,15 +95,15 @@ static inline void __copier(Timestamp ts,
         constexpr EnqFlags RightFlags = EnqFlags(Flags | SAMETASK);
         constexpr EnqFlags LeftFlags =
                 swarm::Hint::__replaceNoWithSame(RightFlags);
-        swarm::enqueue((__copier<LinesPerGrain, Flags>), ts, LeftFlags,
+        swarm::enqueue((__copier<LinesPerGrain, Flags, NonTemporal>), ts, LeftFlags,
                      dest, source, leftHalfBytes);
-        swarm::enqueue((__copier<LinesPerGrain, Flags>), ts, RightFlags,
+        swarm::enqueue((__copier<LinesPerGrain, Flags, NonTemporal>), ts, RightFlags,
                      d_cut, s_cut, bytes - leftHalfBytes);
     }
 }
 
 
-template <EnqFlags Flags, class InputIt, class OutputIt>
+template <EnqFlags Flags, bool NonTemporal, class InputIt, class OutputIt>
 static inline void copy(
         InputIt first, InputIt last,
         OutputIt d_first,
@@ -87,19 +123,19 @@ static inline void copy(
     uint32_t grainSize = swarm::block::grainSize(dest, dest + bytes);
     switch (grainSize) {
         case 1:
-            swarm::enqueue((__copier<1u, Flags>), ts, Flags, dest, source, bytes);
+            swarm::enqueue((__copier<1u, Flags, NonTemporal>), ts, Flags, dest, source, bytes);
             break;
         case 2:
-            swarm::enqueue((__copier<2u, Flags>), ts, Flags, dest, source, bytes);
+            swarm::enqueue((__copier<2u, Flags, NonTemporal>), ts, Flags, dest, source, bytes);
             break;
         case 4:
-            swarm::enqueue((__copier<4u, Flags>), ts, Flags, dest, source, bytes);
+            swarm::enqueue((__copier<4u, Flags, NonTemporal>), ts, Flags, dest, source, bytes);
             break;
         case 8:
-            swarm::enqueue((__copier<8u, Flags>), ts, Flags, dest, source, bytes);
+            swarm::enqueue((__copier<8u, Flags, NonTemporal>), ts, Flags, dest, source, bytes);
             break;
         default:
-            swarm::enqueue((__copier<16u, Flags>), ts, Flags, dest, source, bytes);
+            swarm::enqueue((__copier<16u, Flags, NonTemporal>), ts, Flags, dest, source, bytes);
             break;
     }
 }
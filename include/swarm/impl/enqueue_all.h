@@ -21,8 +21,10 @@
 #include <algorithm>
 #include <functional>
 #include <type_traits>
+#include <boost/iterator/counting_iterator.hpp>
 
 #include "../api.h"
+#include "batch.h"
 #include "type_traits.h"
 
 namespace swarm {
@@ -108,111 +110,270 @@ static inline void __enqueue_for_each(Timestamp ts, Iterator first,
 }
 
 
-// FIXME(mcj) make this port modular than using #ifdefs
-template <typename Iterator>
-static constexpr uint32_t __enqueue_lg_fanout(Iterator first, Iterator last) {
-#if !defined(PLS_ENQUEUE_ALL_2_WAY_FANOUT)
-    // Wide expansion.
+// The (lg of the) enqueuer-tree fanout. The best value scales with the
+// machine: max_children-wide trees leave most of a large machine idle
+// through the expansion phase, while very wide fanouts on small machines
+// overflow the tile task queues and trigger the spillers. Unless a call
+// specifies its own fanout (the Fanout template parameter of enqueue_all)
+// or the build fixes one (PLS_ENQUEUE_ALL_FANOUT), derive the default from
+// the machine once, at first use.
+template <typename T = void> struct __FanoutState { static uint32_t lgFanout; };
+template <typename T> uint32_t __FanoutState<T>::lgFanout;
+
+static inline uint32_t __default_lg_fanout() {
+#if defined(PLS_ENQUEUE_ALL_2_WAY_FANOUT)
+    return 1;
+#elif defined(PLS_ENQUEUE_ALL_FANOUT)
+    static_assert(PLS_ENQUEUE_ALL_FANOUT >= 2 &&
+                  !(PLS_ENQUEUE_ALL_FANOUT & (PLS_ENQUEUE_ALL_FANOUT - 1)),
+                  "PLS_ENQUEUE_ALL_FANOUT must be a power of two >= 2");
+    return swarm::ilog2(PLS_ENQUEUE_ALL_FANOUT);
+#else
+    uint32_t lg = __FanoutState<>::lgFanout;
+    if (lg) return lg;
+    // Wide enough that one enqueuer level can hand a subtree to every tile,
+    // but never below the historical max_children tuning (small machines
+    // are well served by it) nor above max_fanout, which keeps one task's
+    // enqueues well under the capacity of the smallest task queues we
+    // simulate (there is no hook to query the actual capacity).
+    // As in swarm::reduce, the min handles the oracle runtime's
+    // effectively unbounded numTiles().
+    uint32_t tiles = std::min(swarm::numTiles(), swarm::num_threads());
+    uint32_t f = swarm::max_children;
+    while (f < tiles && f < swarm::max_fanout) f *= 2;
+    lg = swarm::ilog2(f);
+    __FanoutState<>::lgFanout = lg;  // benign race: all writers agree
+    return lg;
+#endif
+}
+
+// Resolve the per-call Fanout parameter: 0 selects the machine default
+template <uint32_t Fanout>
+static inline uint32_t __max_lg_fanout() {
+    static_assert(!Fanout || (Fanout >= 2 && !(Fanout & (Fanout - 1))),
+                  "enqueue_all fanout must be a power of two >= 2");
+    return Fanout ? swarm::ilog2(Fanout) : __default_lg_fanout();
+}
+
+// The direct-enqueue threshold below which no tree is spawned: a MaxBaseEnqs
+// of 0 (the default) tracks the effective fanout, so the base level widens
+// with the machine just like the tree levels do
+template <uint32_t MaxBaseEnqs, uint32_t Fanout>
+static inline int64_t __base_enqs() {
+    return MaxBaseEnqs ? MaxBaseEnqs
+                       : (int64_t(1) << __max_lg_fanout<Fanout>());
+}
+
+static inline uint32_t __enqueue_lg_fanout(int64_t size, uint32_t maxlg) {
+    // Wide expansion only for ranges that feed it.
     // Notice that with only 10 elements to iterate over, we want a
     // fanout of 2, otherwise each leaf enqueuer would wrap only 1 to 2
-    // real tasks. With, say, 1024 elements, we want that large fanout
-    // of 8. The following formula provides a fanout of 4 for 17
-    // elements, yielding leaf enqueuers that wrap 4 to 5 real tasks.
-    constexpr int64_t T = swarm::max_children * swarm::max_children / 2;
-    if ((last - first) > T) return swarm::ilog2(swarm::max_children);
-    if ((last - first) > T / 2) return swarm::ilog2(swarm::max_children / 2);
+    // real tasks; with, say, 1024 elements, we want the full fanout.
+    // With at least fanout^2/2 elements each leaf enqueuer wraps at least
+    // fanout/2 real tasks, so use the full fanout; halve it for ranges
+    // half that size, and fall back to 2-way below that.
+    const int64_t full = int64_t(1) << (2 * maxlg - 1);
+    if (size > full) return maxlg;
+    if (size > full / 2 && maxlg > 1) return maxlg - 1;
+    return 1;
+}
+
+
+// A stable global index for an enqueuer subtree's start, used to stripe the
+// tree across tiles below. Counting iterators give their value; otherwise
+// assume contiguous storage and use the element's address.
+template <typename I>
+static inline uint64_t __enqueuerIndex(boost::counting_iterator<I> it) {
+    return static_cast<uint64_t>(*it);
+}
+
+template <typename Iterator>
+static inline uint64_t __enqueuerIndex(Iterator it) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    return reinterpret_cast<uintptr_t>(&(*it)) / sizeof(T);
+}
+
+// The hint for an enqueuer over a subtree of `subtree` elements starting at
+// `start`. With NOHINT the hint-hashing can pile intermediate enqueuers onto
+// few tiles while others idle during the expansion phase, so instead stripe
+// the tree across tiles with NOHASH hints: each tree level splits ranges at
+// multiples of the subtree size, so index/subtree is the subtree's ordinal
+// within its level, and consecutive subtrees land on consecutive tiles.
+// Hinted (non-NOHINT) enqueuers keep the caller's placement; Left keeps the
+// old courtesy of running the left-most child on the parent's tile, which
+// only applies when striping is off.
+template <EnqFlags Flags, bool Left = false, typename Iterator>
+static inline swarm::Hint __enqueuerHint(Iterator start, uint64_t subtree) {
+#ifndef PLS_ENQUEUE_ALL_NO_TILE_STRIPE
+    if (Flags & EnqFlags::NOHINT) {
+        uint64_t ordinal = __enqueuerIndex(start) / std::max(subtree, 1ul);
+        return {ordinal % swarm::numTiles(),
+                EnqFlags((Flags & ~NOHINT) | NOHASH)};
+    }
 #endif
-    return swarm::ilog2(2);
+    constexpr EnqFlags F = Left ? swarm::Hint::__replaceNoWithSame(Flags)
+                                : Flags;
+    return swarm::Hint(F);
 }
 
 
 // Do not call this directly
-template <typename Iterator, typename EnqOneFn, EnqFlags Flags>
+template <typename Iterator, typename EnqOneFn, EnqFlags Flags,
+          uint32_t Fanout>
 static inline void __enqueuer(Timestamp ts, Iterator first, Iterator last,
         EnqOneFn enq) {
     // TODO(mcj) the following only works for
     // http://en.cppreference.com/w/cpp/concept/RandomAccessIterator
     // To generalize, we could use a local integer counter, but that adds more
     // operations to the loop.
-    if ((last - first) <= swarm::max_children) {
+    const uint32_t maxlg = __max_lg_fanout<Fanout>();
+    if ((last - first) <= (int64_t(1) << maxlg)) {
         __enqueue_for_each(ts, first, last, enq);
     } else {
-        const uint32_t lgfanout = __enqueue_lg_fanout(first, last);
-        // If we're supposed to use NOHINT, for the left-most child there's
-        // little harm in using SAMEHINT, and avoiding the NoC latency to start
-        // the left-most __enqueuer.
-        constexpr EnqFlags LeftFlags = swarm::Hint::__replaceNoWithSame(Flags);
+        const uint32_t lgfanout = __enqueue_lg_fanout(last - first, maxlg);
+        const uint64_t csize = (last - first) >> lgfanout;
 
         Iterator start = first;
-        Iterator end = start + ((last - first) >> lgfanout);
-        swarm::enqueue((__enqueuer<Iterator, EnqOneFn, Flags>),
-                     ts, LeftFlags, start, end, enq);
-        for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+        Iterator end = start + csize;
+        swarm::enqueue((__enqueuer<Iterator, EnqOneFn, Flags, Fanout>),
+                     ts, __enqueuerHint<Flags, true>(start, csize),
+                     start, end, enq);
+        if (__batchableFlags(Flags) && lgfanout >= 2) {
+            // Wide fanout: submit the right siblings with one magic op
+            swarm::TaskBatch<swarm::max_fanout> batch;
+            for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+                start = end;
+                end = start + csize;
+                enqueue_batch(batch,
+                              (__enqueuer<Iterator, EnqOneFn, Flags, Fanout>),
+                              ts, __enqueuerHint<Flags>(start, csize),
+                              start, end, enq);
+            }
             start = end;
-            end = start + ((last - first) >> lgfanout);
-            swarm::enqueue((__enqueuer<Iterator, EnqOneFn, Flags>),
-                         ts, Flags, start, end, enq);
+            enqueue_batch(batch,
+                          (__enqueuer<Iterator, EnqOneFn, Flags, Fanout>),
+                          ts, __enqueuerHint<Flags>(start, csize),
+                          start, last, enq);
+        } else {
+            for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+                start = end;
+                end = start + csize;
+                swarm::enqueue((__enqueuer<Iterator, EnqOneFn, Flags, Fanout>),
+                             ts, __enqueuerHint<Flags>(start, csize),
+                             start, end, enq);
+            }
+            start = end;
+            swarm::enqueue((__enqueuer<Iterator, EnqOneFn, Flags, Fanout>),
+                         ts, __enqueuerHint<Flags>(start, csize),
+                         start, last, enq);
         }
-        start = end;
-        swarm::enqueue((__enqueuer<Iterator, EnqOneFn, Flags>),
-                     ts, Flags, start, last, enq);
     }
 }
 
 
 // Do not call this directly.
 // A variant of __enqueuer when EnqOneFn is a stateless lambda
-template <typename Iterator, typename EnqOneFn, EnqFlags Flags>
+template <typename Iterator, typename EnqOneFn, EnqFlags Flags,
+          uint32_t Fanout>
 static inline void __enqueuerNoLmb(Timestamp ts, Iterator first, Iterator last) {
-    if ((last - first) <= swarm::max_children) {
+    const uint32_t maxlg = __max_lg_fanout<Fanout>();
+    if ((last - first) <= (int64_t(1) << maxlg)) {
         // Get a callable function object from the enqueue lambda type.  NOTE:
         // lambdas aren't constexpr in C++14, but can be constexpr in C++17.
         const auto enq = swarm::make_lambda<EnqOneFn>{}();
         __enqueue_for_each(ts, first, last, enq);
     } else {
-        const uint32_t lgfanout = __enqueue_lg_fanout(first, last);
-        constexpr EnqFlags LeftFlags = swarm::Hint::__replaceNoWithSame(Flags);
+        const uint32_t lgfanout = __enqueue_lg_fanout(last - first, maxlg);
+        const uint64_t csize = (last - first) >> lgfanout;
 
         Iterator start = first;
-        Iterator end = start + ((last - first) >> lgfanout);
-        swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, Flags>),
-                     ts, LeftFlags, start, end);
-        for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+        Iterator end = start + csize;
+        swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, Flags, Fanout>),
+                     ts, __enqueuerHint<Flags, true>(start, csize),
+                     start, end);
+        if (__batchableFlags(Flags) && lgfanout >= 2) {
+            swarm::TaskBatch<swarm::max_fanout> batch;
+            for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+                start = end;
+                end = start + csize;
+                enqueue_batch(batch,
+                        (__enqueuerNoLmb<Iterator, EnqOneFn, Flags, Fanout>),
+                        ts, __enqueuerHint<Flags>(start, csize),
+                        start, end);
+            }
+            start = end;
+            enqueue_batch(batch,
+                    (__enqueuerNoLmb<Iterator, EnqOneFn, Flags, Fanout>),
+                    ts, __enqueuerHint<Flags>(start, csize),
+                    start, last);
+        } else {
+            for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+                start = end;
+                end = start + csize;
+                swarm::enqueue(
+                        (__enqueuerNoLmb<Iterator, EnqOneFn, Flags, Fanout>),
+                        ts, __enqueuerHint<Flags>(start, csize),
+                        start, end);
+            }
             start = end;
-            end = start + ((last - first) >> lgfanout);
-            swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, Flags>),
-                         ts, Flags, start, end);
+            swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, Flags, Fanout>),
+                         ts, __enqueuerHint<Flags>(start, csize),
+                         start, last);
         }
-        start = end;
-        swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, Flags>),
-                     ts, Flags, start, last);
     }
 }
 
 
 // Do not call this directly
-template <typename Iterator, typename EnqOneFn, typename TSFn, EnqFlags Flags>
+template <typename Iterator, typename EnqOneFn, typename TSFn, EnqFlags Flags,
+          uint32_t Fanout>
 static inline void __enqueuerTSFn(Timestamp ts, Iterator first, Iterator last,
         TSFn tsfn, EnqOneFn enq) {
-    if ((last - first) <= swarm::max_children) {
+    const uint32_t maxlg = __max_lg_fanout<Fanout>();
+    if ((last - first) <= (int64_t(1) << maxlg)) {
         __enqueue_for_each(tsfn(*first), first, last, enq);
     } else {
-        const uint32_t lgfanout = __enqueue_lg_fanout(first, last);
-        constexpr EnqFlags LeftFlags = swarm::Hint::__replaceNoWithSame(Flags);
+        const uint32_t lgfanout = __enqueue_lg_fanout(last - first, maxlg);
+        const uint64_t csize = (last - first) >> lgfanout;
         Iterator start = first;
-        Iterator end = start + ((last - first) >> lgfanout);
+        Iterator end = start + csize;
         // Note: ts == tsfn(*first)
-        swarm::enqueue((__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags>),
-                     ts, LeftFlags, start, end, tsfn, enq);
-        for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+        swarm::enqueue(
+                (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags, Fanout>),
+                ts, __enqueuerHint<Flags, true>(start, csize),
+                start, end, tsfn, enq);
+        if (__batchableFlags(Flags) && lgfanout >= 2) {
+            swarm::TaskBatch<swarm::max_fanout> batch;
+            for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+                start = end;
+                end = start + csize;
+                enqueue_batch(batch,
+                        (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags,
+                                        Fanout>),
+                        tsfn(*start), __enqueuerHint<Flags>(start, csize),
+                        start, end, tsfn, enq);
+            }
             start = end;
-            end = start + ((last - first) >> lgfanout);
-            swarm::enqueue((__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags>),
-                         tsfn(*start), Flags, start, end, tsfn, enq);
+            enqueue_batch(batch,
+                    (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags, Fanout>),
+                    tsfn(*start), __enqueuerHint<Flags>(start, csize),
+                    start, last, tsfn, enq);
+        } else {
+            for (uint32_t i = 1u; i < (1u << lgfanout) - 1u; i++) {
+                start = end;
+                end = start + csize;
+                swarm::enqueue(
+                        (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags,
+                                        Fanout>),
+                        tsfn(*start), __enqueuerHint<Flags>(start, csize),
+                        start, end, tsfn, enq);
+            }
+            start = end;
+            swarm::enqueue(
+                    (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags, Fanout>),
+                    tsfn(*start), __enqueuerHint<Flags>(start, csize),
+                    start, last, tsfn, enq);
         }
-        start = end;
-        swarm::enqueue((__enqueuerTSFn<Iterator, EnqOneFn, TSFn, Flags>),
-                     tsfn(*start), Flags, start, last, tsfn, enq);
     }
 }
 
@@ -230,6 +391,7 @@ static inline void __enqueuerTSFn(Timestamp ts, Iterator first, Iterator last,
 template <EnqFlags FirstFlags,
           EnqFlags ChildFlags,
           uint32_t MaxBaseEnqs,
+          uint32_t Fanout,
           typename Iterator,
           typename EnqOneFn,
           typename TSFn,
@@ -239,7 +401,7 @@ struct __EnqueueAll {
     inline void operator()(Iterator first, Iterator last,
                            EnqOneFn enq, TSFn tsfn) {
 #ifndef SEQ_RUNTIME
-        if ((last - first) <= MaxBaseEnqs) {
+        if ((last - first) <= __base_enqs<MaxBaseEnqs, Fanout>()) {
 #else
         if (true) {
 #endif
@@ -247,14 +409,21 @@ struct __EnqueueAll {
             return;
         }
 
-        Iterator midpoint = (MaxBaseEnqs > 1) ?
+        Iterator midpoint = (MaxBaseEnqs != 1) ?
                 (first + (last - first) / 2) :
                 last;
-        swarm::enqueue((__enqueuerTSFn<Iterator, EnqOneFn, TSFn, ChildFlags>),
-                     tsfn(*first), FirstFlags, first, midpoint, tsfn, enq);
-        if (MaxBaseEnqs > 1) {
-            swarm::enqueue((__enqueuerTSFn<Iterator, EnqOneFn, TSFn, ChildFlags>),
-                         tsfn(*midpoint), FirstFlags, midpoint, last, tsfn, enq);
+        const uint64_t csize = midpoint - first;
+        swarm::enqueue(
+                (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, ChildFlags, Fanout>),
+                tsfn(*first), __enqueuerHint<FirstFlags>(first, csize),
+                first, midpoint, tsfn, enq);
+        if (MaxBaseEnqs != 1) {
+            swarm::enqueue(
+                    (__enqueuerTSFn<Iterator, EnqOneFn, TSFn, ChildFlags,
+                                    Fanout>),
+                    tsfn(*midpoint),
+                    __enqueuerHint<FirstFlags>(midpoint, csize),
+                    midpoint, last, tsfn, enq);
         }
     }
 
@@ -264,10 +433,11 @@ struct __EnqueueAll {
 template <EnqFlags FirstFlags,
           EnqFlags ChildFlags,
           uint32_t MaxBaseEnqs,
+          uint32_t Fanout,
           typename Iterator,
           typename EnqOneFn,
           typename TimestampType>
-struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
+struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs, Fanout,
         Iterator, EnqOneFn, TimestampType,
         typename std::enable_if< swarm::conjunction<
               std::is_integral<TimestampType>
@@ -280,7 +450,7 @@ struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
                            EnqOneFn enq, TimestampType ts) {
         swarm::Timestamp enqTS = static_cast<swarm::Timestamp>(ts);
 #ifndef SEQ_RUNTIME
-        if ((last - first) <= MaxBaseEnqs) {
+        if ((last - first) <= __base_enqs<MaxBaseEnqs, Fanout>()) {
 #else
         if (true) {
 #endif
@@ -288,14 +458,19 @@ struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
             return;
         }
 
-        Iterator midpoint = (MaxBaseEnqs > 1) ?
+        Iterator midpoint = (MaxBaseEnqs != 1) ?
                 (first + (last - first) / 2) :
                 last;
-        swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, ChildFlags>),
-                     enqTS, FirstFlags, first, midpoint);
-        if (MaxBaseEnqs > 1) {
-            swarm::enqueue((__enqueuerNoLmb<Iterator, EnqOneFn, ChildFlags>),
-                         enqTS, FirstFlags, midpoint, last);
+        const uint64_t csize = midpoint - first;
+        swarm::enqueue(
+                (__enqueuerNoLmb<Iterator, EnqOneFn, ChildFlags, Fanout>),
+                enqTS, __enqueuerHint<FirstFlags>(first, csize),
+                first, midpoint);
+        if (MaxBaseEnqs != 1) {
+            swarm::enqueue(
+                    (__enqueuerNoLmb<Iterator, EnqOneFn, ChildFlags, Fanout>),
+                    enqTS, __enqueuerHint<FirstFlags>(midpoint, csize),
+                    midpoint, last);
         }
     }
 };
@@ -305,10 +480,11 @@ struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
 template <EnqFlags FirstFlags,
           EnqFlags ChildFlags,
           uint32_t MaxBaseEnqs,
+          uint32_t Fanout,
           typename Iterator,
           typename EnqOneFn,
           typename TimestampType>
-struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
+struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs, Fanout,
         Iterator, EnqOneFn, TimestampType,
         typename std::enable_if< swarm::conjunction<
               std::is_integral<TimestampType>
@@ -320,19 +496,23 @@ struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
     inline void operator()(Iterator first, Iterator last,
                            EnqOneFn enq, TimestampType ts) {
         swarm::Timestamp enqTS = static_cast<swarm::Timestamp>(ts);
-        if ((last - first) <= MaxBaseEnqs) {
+        if ((last - first) <= __base_enqs<MaxBaseEnqs, Fanout>()) {
             __enqueue_for_each(enqTS, first, last, enq);
             return;
         }
 
-        Iterator midpoint = (MaxBaseEnqs > 1) ?
+        Iterator midpoint = (MaxBaseEnqs != 1) ?
                 (first + (last - first) / 2) :
                 last;
-        swarm::enqueue((__enqueuer<Iterator, EnqOneFn, ChildFlags>),
-                     enqTS, FirstFlags, first, midpoint, enq);
-        if (MaxBaseEnqs > 1) {
-            swarm::enqueue((__enqueuer<Iterator, EnqOneFn, ChildFlags>),
-                         enqTS, FirstFlags, midpoint, last, enq);
+        const uint64_t csize = midpoint - first;
+        swarm::enqueue((__enqueuer<Iterator, EnqOneFn, ChildFlags, Fanout>),
+                     enqTS, __enqueuerHint<FirstFlags>(first, csize),
+                     first, midpoint, enq);
+        if (MaxBaseEnqs != 1) {
+            swarm::enqueue(
+                    (__enqueuer<Iterator, EnqOneFn, ChildFlags, Fanout>),
+                    enqTS, __enqueuerHint<FirstFlags>(midpoint, csize),
+                    midpoint, last, enq);
         }
     }
 };
@@ -340,6 +520,7 @@ struct __EnqueueAll<FirstFlags, ChildFlags, MaxBaseEnqs,
 
 template <EnqFlags Flags,
           uint32_t MaxBaseEnqs,
+          uint32_t Fanout,
           typename Iterator,
           typename EnqOneFn,
           typename TimestampType>
@@ -356,7 +537,7 @@ static inline void enqueue_all(Iterator first, Iterator last,
     constexpr EnqFlags FirstFlags = EnqFlags(Flags | PRODUCER);
     constexpr EnqFlags ChildFlags = EnqFlags(FirstFlags | SAMETASK);
     __EnqueueAll<FirstFlags, ChildFlags,
-                 MaxBaseEnqs,
+                 MaxBaseEnqs, Fanout,
                  Iterator, EnqOneFn, TimestampType> ea;
     ea(first, last, enq, tstype);
 }
@@ -422,7 +603,7 @@ static inline void enqueue_all(Iterator first, Iterator last,
             "We require iterators with constant-time random access.");
 
 #ifndef SEQ_RUNTIME
-    if ((last - first) <= MaxBaseEnqs) {
+    if ((last - first) <= __base_enqs<MaxBaseEnqs, 0>()) {
 #else
     if (true) {
 #endif
@@ -441,11 +622,11 @@ static inline void enqueue_all(Iterator first, Iterator last,
         // whole range of __enqueuers can use MAYSPEC.
         swarm::Hint h(hl(*first));
         if (h.flags & EnqFlags::MAYSPEC) {
-            swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), MaxBaseEnqs, Iterator,
-                             EnqueueLambda, TimestampLambda>
+            swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), MaxBaseEnqs, 0,
+                             Iterator, EnqueueLambda, TimestampLambda>
                             (first, last, el, tsl);
         } else {
-            swarm::enqueue_all<NOHINT, MaxBaseEnqs, Iterator,
+            swarm::enqueue_all<NOHINT, MaxBaseEnqs, 0, Iterator,
                              EnqueueLambda, TimestampLambda>
                             (first, last, el, tsl);
         }
@@ -602,7 +783,7 @@ static inline void enqueue_all_progressive(Iterator first, Iterator last,
             "We require iterators with constant-time random access.");
 
 #ifndef SEQ_RUNTIME
-    if ((last - first) <= MaxBaseEnqs) {
+    if ((last - first) <= __base_enqs<MaxBaseEnqs, 0>()) {
 #else
     if (true) {
 #endif
@@ -639,4 +820,96 @@ static inline void enqueue_all_progressive(Iterator first, Iterator last,
     }
 }
 
+
+template <uint32_t EnqueuesPerTask,
+          typename Iterator,
+          typename Predicate,
+          typename EnqueueLambda,
+          typename TimestampLambda,
+          typename HintLambda>
+struct __EnqueueWhile {
+    Predicate p;
+    EnqueueLambda el;
+    TimestampLambda tsl;
+    HintLambda hl;
+    uint32_t maxstride;
+
+    void operator()(swarm::Timestamp ts, Iterator begin, uint32_t stride) const {
+        // Drain the chunk up to the sentinel; crossing it ends this strand
+        Iterator end = begin + EnqueuesPerTask;
+        Iterator stop = begin;
+        while (stop != end && p(*stop)) ++stop;
+        __enqueue_for_each(ts, begin, stop, el);
+        if (stop != end) return;
+
+        Iterator left = begin + stride;
+        Iterator right = begin + 2 * stride;
+        if (!p(*left)) return;
+        if (stride < maxstride && p(*right)) {
+            // Probing p keeps us from spawning a strand past the sentinel,
+            // where it would be born dead
+            reenqueue(left, 2 * stride);
+            reenqueue(right, 2 * stride);
+        } else {
+            reenqueue(left, stride);
+        }
+    }
+
+    inline void reenqueue(Iterator begin, uint32_t strands) const {
+        swarm::Hint h(hl(*begin));
+        swarm::enqueueLambda(*this,
+                tsl(*begin),
+                {h.hint, EnqFlags(h.flags | PRODUCER | SAMETASK)},
+                begin,
+                strands);
+    }
+};
+
+
+// An enqueue_all over a range whose trip count isn't known up front: apply
+// the enqueue lambda to consecutive elements starting at first while pred
+// holds, gradually expanding into parallel strands like
+// enqueue_all_progressive. The first failing element is the sentinel:
+// pred must be safe to evaluate on any element at or past it, and must
+// fail for all of them. Dynamically growing ranges (worklists) work as
+// long as the producer that publishes an element (makes pred hold) runs
+// no later than the element's tsl; speculation then orders each probe of
+// pred after the publish.
+template <uint32_t EnqueuesPerTask,
+          uint32_t MaxStrands,
+          typename Iterator,
+          typename Predicate,
+          typename EnqueueLambda,
+          typename TimestampLambda,
+          typename HintLambda>
+static inline void enqueue_all_while(Iterator first, Predicate pred,
+        EnqueueLambda el, TimestampLambda tsl, HintLambda hl) {
+    static_assert(EnqueuesPerTask < swarm::max_children,
+            "Number of enqueues per enqueuer task must be < max_children");
+    static_assert(
+            std::is_convertible<
+                    typename std::iterator_traits<Iterator>::iterator_category,
+                    std::random_access_iterator_tag>::value,
+            "We require iterators with constant-time random access.");
+
+    if (!pred(*first)) return;
+
+    // Unlike the variants above there is no serial shortcut, even for the
+    // SEQ runtime: pred may depend on producer tasks that haven't run yet,
+    // so every probe must come from a task ordered by its element's tsl.
+    uint32_t maxstrands = std::min(swarm::num_threads() * 4u, MaxStrands);
+    using EW = __EnqueueWhile<EnqueuesPerTask, Iterator, Predicate,
+                              EnqueueLambda, TimestampLambda, HintLambda>;
+    // By value, unlike __EnqueueProgressiveByPointer: strands die at
+    // unpredictable times, so there is no single place to free shared
+    // state. Keep the captures small to stay in the register-passed path.
+    EW ew{pred, el, tsl, hl, maxstrands * EnqueuesPerTask};
+    swarm::Hint h(hl(*first));
+    swarm::enqueueLambda(ew,
+            tsl(*first),
+            {h.hint, EnqFlags(h.flags | PRODUCER)},
+            first,
+            EnqueuesPerTask);
+}
+
 }
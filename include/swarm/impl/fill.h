@@ -17,7 +17,12 @@
  */
 
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "../algorithm.h"
 #include "../api.h"
 #include "block.h"
@@ -25,9 +30,83 @@
 namespace swarm {
 
 
+// Whether a fill of T can be lowered to 16-byte vector stores: the value must
+// be bit-copyable and tile a vector register exactly.
+template <typename T>
+struct __is_vectorizable_fill {
+    static constexpr bool value =
+            std::is_trivially_copyable<T>::value &&
+            sizeof(T) <= 16 && (16 % sizeof(T)) == 0;
+};
+
+#ifdef __SSE2__
+// Tag dispatch so the streaming kernel is only instantiated when it applies;
+// both branches of a plain if would be compiled (no constexpr if in C++14).
+template <bool Stream, class Iterator, class T>
+struct __NtFiller {
+    static inline void fill(Iterator first, Iterator last, const T& value) {
+        std::fill(first, last, value);
+    }
+};
+
+// Fill [first, last) with non-temporal 16-byte stores, bypassing the caches.
+// Head and tail elements around the aligned middle use ordinary stores.
+template <class Iterator, class T>
+static inline void __ntFill(Iterator first, Iterator last, const T& value) {
+    T* d = &(*first);
+    T* end = d + (last - first);
+
+    uintptr_t misalign = reinterpret_cast<uintptr_t>(d) & 15;
+    if (misalign % sizeof(T) != 0) {
+        // Can't reach a vector boundary on an element boundary
+        std::fill(d, end, value);
+        return;
+    }
+    T* head = d + std::min<size_t>((16 - misalign) / sizeof(T) % (16 / sizeof(T)),
+                                   end - d);
+    std::fill(d, head, value);
+    d = head;
+
+    char pattern[16];
+    for (size_t i = 0; i < 16 / sizeof(T); i++)
+        std::memcpy(pattern + i * sizeof(T), &value, sizeof(T));
+    __m128i pat = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+
+    size_t vecs = (end - d) * sizeof(T) / 16;
+    __m128i* vd = reinterpret_cast<__m128i*>(d);
+    for (size_t i = 0; i < vecs; i++) _mm_stream_si128(vd + i, pat);
+    d += vecs * (16 / sizeof(T));
+
+    std::fill(d, end, value);
+    // Streaming stores are weakly ordered; fence before this task finishes so
+    // consumer tasks observe the fill.
+    _mm_sfence();
+}
+
 template <class Iterator, class T>
+struct __NtFiller<true, Iterator, T> {
+    static inline void fill(Iterator first, Iterator last, const T& value) {
+        __ntFill(first, last, value);
+    }
+};
+#endif
+
+template <bool NonTemporal, class Iterator, class T>
 static inline void __writer(Timestamp, Iterator first, Iterator last, const T& value) {
+#ifdef __SSE2__
+    // gcc already vectorizes the temporal std::fill for simple element types;
+    // the win here is the non-temporal variant for buffers that won't be
+    // re-read before eviction, which keeps multi-GB fills out of the caches
+    // entirely. The kernel needs raw element storage, so wrapper value types
+    // (e.g. swarm::aligned<T> filled from a T) take the temporal path.
+    constexpr bool stream = NonTemporal &&
+            __is_vectorizable_fill<T>::value &&
+            std::is_same<typename std::iterator_traits<Iterator>::value_type,
+                         T>::value;
+    __NtFiller<stream, Iterator, T>::fill(first, last, value);
+#else
     std::fill(first, last, value);
+#endif
 }
 
 
@@ -35,7 +114,7 @@ static inline void __writer(Timestamp, Iterator first, Iterator last, const T& v
 // FIXME(mcj) this is dangerously assuming use of ContiguousIterators
 // (http://en.cppreference.com/w/cpp/iterator), but doesn't actually check which
 // type of iterator is used.
-template <uint8_t BlockSize, EnqFlags Flags, class Iterator, typename T>
+template <uint8_t BlockSize, EnqFlags Flags, bool NonTemporal, class Iterator, typename T>
 static inline void fill_impl(Timestamp ts, Iterator first, Iterator last, const T& value) {
   constexpr unsigned grainSize = swarm::block::elementsPerGrain<BlockSize, Iterator>();
   constexpr size_t elemSize = sizeof(*first);
@@ -61,7 +140,7 @@ static inline void fill_impl(Timestamp ts, Iterator first, Iterator last, const
   size_t firstBytes = firstAddrRoundedUp - firstAddr;
   assert(firstBytes % elemSize == 0);
   Iterator firstRoundedUp = first + (firstBytes / elemSize);
-  swarm::enqueue((__writer<Iterator, T>), ts, Flags, first, firstRoundedUp, value);
+  swarm::enqueue((__writer<NonTemporal, Iterator, T>), ts, Flags, first, firstRoundedUp, value);
 
   // Now, spawn tasks to fill each grain in the rest of the range
   // [firstRoundedUp, last)
@@ -77,7 +156,7 @@ static inline void fill_impl(Timestamp ts, Iterator first, Iterator last, const
   swarm::enqueue_all<Flags, swarm::max_children - 2>(
       u32it(0), u32it(grains),
       [firstRoundedUp, value](Timestamp ts, uint64_t i) {
-          swarm::enqueue((__writer<Iterator, T>), ts, Flags,
+          swarm::enqueue((__writer<NonTemporal, Iterator, T>), ts, Flags,
                          firstRoundedUp + (i * grainSize),
                          firstRoundedUp + ((i + 1) * grainSize),
                          value);
@@ -87,12 +166,14 @@ static inline void fill_impl(Timestamp ts, Iterator first, Iterator last, const
   Iterator lastRoundedDown = firstRoundedUp + (grains * grainSize);
   assert(lastRoundedDown <= last);
   if (lastRoundedDown < last)
-      swarm::enqueue((__writer<Iterator, T>), ts, Flags, lastRoundedDown, last, value);
+      swarm::enqueue((__writer<NonTemporal, Iterator, T>), ts, Flags, lastRoundedDown, last, value);
 }
 
 
 // TODO(mcj) add support for hints
-template <EnqFlags Flags, class Iterator, typename T>
+// NonTemporal selects the streaming-store kernel for buffers that won't be
+// re-read soon; see __writer above.
+template <EnqFlags Flags, bool NonTemporal, class Iterator, typename T>
 static inline void fill(Iterator first, Iterator last, const T& value,
         Timestamp ts) {
     static_assert(!(Flags & EnqFlags::SAMETASK), "SAMETASK is invalid here");
@@ -102,31 +183,31 @@ static inline void fill(Iterator first, Iterator last, const T& value,
     switch(blockSize) {
         case 1:
         {
-            swarm::enqueue((fill_impl<1u, Flags, Iterator, T>),
+            swarm::enqueue((fill_impl<1u, Flags, NonTemporal, Iterator, T>),
                     ts, Flags, first, last, value);
             break;
         }
         case 2:
         {
-            swarm::enqueue((fill_impl<2u, Flags, Iterator, T>),
+            swarm::enqueue((fill_impl<2u, Flags, NonTemporal, Iterator, T>),
                     ts, Flags, first, last, value);
             break;
         }
         case 4:
         {
-            swarm::enqueue((fill_impl<4u, Flags, Iterator, T>),
+            swarm::enqueue((fill_impl<4u, Flags, NonTemporal, Iterator, T>),
                     ts, Flags, first, last, value);
             break;
         }
         case 8:
         {
-            swarm::enqueue((fill_impl<8u, Flags, Iterator, T>),
+            swarm::enqueue((fill_impl<8u, Flags, NonTemporal, Iterator, T>),
                     ts, Flags, first, last, value);
             break;
         }
         default:
         {
-            swarm::enqueue((fill_impl<16u, Flags, Iterator, T>),
+            swarm::enqueue((fill_impl<16u, Flags, NonTemporal, Iterator, T>),
                     ts, Flags, first, last, value);
             break;
         }
@@ -0,0 +1,231 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "../api.h"
+#include "../algorithm.h"
+#include "block.h"
+
+namespace swarm {
+namespace _find {
+
+// Both searches below scan position-ordered blocks at increasing timestamps
+// inside a deepened domain, so "first in the range" and "earliest timestamp"
+// coincide and timestamp order resolves ties. Domain timestamp 1 is reserved:
+// a hitting find_if task lowers itself there via setGvt before publishing.
+
+template <class Iterator, class Predicate, class CallBackLambda>
+struct Finder {
+    swarm::Timestamp cbts;
+    CallBackLambda cb;
+    Predicate pred;
+    Iterator first;
+    Iterator last;
+    uint64_t numTasks;
+    Iterator result;
+    volatile bool done;  // read by every scan task before it scans
+
+    Finder(swarm::Timestamp ts, CallBackLambda _cb, Predicate _pred,
+           Iterator _first, Iterator _last)
+        : cbts(ts)
+        , cb(_cb)
+        , pred(_pred)
+        , first(_first)
+        , last(_last)
+        , numTasks(1 + (std::distance(first, last) - 1) / blockSize())
+        , result(_last)
+        , done(false)
+    {}
+
+    inline void operator() (swarm::Timestamp) {
+        if (numTasks == 1) {
+            Iterator r = std::find_if(first, last, pred);
+            swarm::enqueueLambda(cb, cbts, EnqFlags::NOHINT, r);
+            free(this);
+        } else {
+            swarm::deepen();
+
+            swarm::enqueue_all<swarm::max_children - 4, swarm::max_children - 1>(
+                    swarm::u64it(0ul), swarm::u64it(numTasks),
+                    [this] (swarm::Timestamp ts, uint64_t b) {
+                Iterator begin = this->first + b * blockSize();
+                swarm::enqueue(Finder::scanBlock, ts,
+                        {swarm::Hint::cacheLine(&(*begin)), EnqFlags::MAYSPEC},
+                        this, b);
+            },
+            [] (uint64_t b) { return 2 + b; },
+            [] (uint64_t) { return EnqFlags(NOHINT | MAYSPEC); });
+
+            swarm::enqueue(Finder::finish, 2 + numTasks,
+                         EnqFlags(NOHINT | CANTSPEC), this);
+        }
+    }
+
+    static void scanBlock(swarm::Timestamp, Finder* f, uint64_t b) {
+        // A hit at a lower timestamp squashes us on this read; the re-run
+        // exits here without scanning
+        if (f->done) return;
+        Iterator begin = f->first + b * blockSize();
+        Iterator end = (b == f->numTasks - 1) ? f->last
+                                              : begin + blockSize();
+        Iterator r = std::find_if(begin, end, f->pred);
+        if (r != end) {
+            // Drop to the reserved timestamp below all remaining scan tasks,
+            // so the writes that follow conflict with their done reads and
+            // squash any block that raced ahead speculatively
+            swarm::setGvt(1);
+            f->done = true;
+            f->result = r;
+        }
+    }
+
+    static void finish(swarm::Timestamp, Finder* f) {
+        Iterator r = f->result;
+        swarm::enqueueLambda(f->cb, f->cbts,
+                             EnqFlags(NOHINT | PARENTDOMAIN), r);
+        free(f);
+    }
+
+    static constexpr uint32_t blockSize() {
+        constexpr uint32_t epl = swarm::block::elementsPerLine<Iterator>();
+        return std::max(epl, 2u);
+    }
+};
+
+
+// Unlike find_if, a minimum search must visit every element, so there is no
+// setGvt early exit; instead the shared best is updated read-first (the
+// priority_update idiom), so blocks that don't improve on it keep an empty
+// write-set.
+template <class Iterator, class Compare, class CallBackLambda>
+struct MinFinder {
+    swarm::Timestamp cbts;
+    CallBackLambda cb;
+    Compare cmp;
+    Iterator first;
+    Iterator last;
+    uint64_t numTasks;
+    Iterator bestIt;  // == last until the first block publishes
+
+    MinFinder(swarm::Timestamp ts, CallBackLambda _cb, Compare _cmp,
+              Iterator _first, Iterator _last)
+        : cbts(ts)
+        , cb(_cb)
+        , cmp(_cmp)
+        , first(_first)
+        , last(_last)
+        , numTasks(1 + (std::distance(first, last) - 1) / blockSize())
+        , bestIt(_last)
+    {}
+
+    inline void operator() (swarm::Timestamp) {
+        if (numTasks == 1) {
+            Iterator r = std::min_element(first, last, cmp);
+            swarm::enqueueLambda(cb, cbts, EnqFlags::NOHINT, r);
+            free(this);
+        } else {
+            swarm::deepen();
+
+            swarm::enqueue_all<swarm::max_children - 4, swarm::max_children - 1>(
+                    swarm::u64it(0ul), swarm::u64it(numTasks),
+                    [this] (swarm::Timestamp ts, uint64_t b) {
+                Iterator begin = this->first + b * blockSize();
+                swarm::enqueue(MinFinder::scanBlock, ts,
+                        {swarm::Hint::cacheLine(&(*begin)), EnqFlags::MAYSPEC},
+                        this, b);
+            },
+            [] (uint64_t b) { return 2 + b; },
+            [] (uint64_t) { return EnqFlags(NOHINT | MAYSPEC); });
+
+            swarm::enqueue(MinFinder::finish, 2 + numTasks,
+                         EnqFlags(NOHINT | CANTSPEC), this);
+        }
+    }
+
+    static void scanBlock(swarm::Timestamp, MinFinder* m, uint64_t b) {
+        Iterator begin = m->first + b * blockSize();
+        Iterator end = (b == m->numTasks - 1) ? m->last
+                                              : begin + blockSize();
+        Iterator lm = std::min_element(begin, end, m->cmp);
+        // Strict comparison: on ties the earlier-timestamped (and therefore
+        // earlier-positioned) block's element stands, matching
+        // std::min_element's first-occurrence rule
+        if (m->bestIt == m->last || m->cmp(*lm, *m->bestIt)) m->bestIt = lm;
+    }
+
+    static void finish(swarm::Timestamp, MinFinder* m) {
+        Iterator r = m->bestIt;
+        swarm::enqueueLambda(m->cb, m->cbts,
+                             EnqFlags(NOHINT | PARENTDOMAIN), r);
+        free(m);
+    }
+
+    static constexpr uint32_t blockSize() {
+        constexpr uint32_t epl = swarm::block::elementsPerLine<Iterator>();
+        return std::max(epl, 2u);
+    }
+};
+
+} // end namespace _find
+
+
+template <class Iterator, class Predicate, class CallBackLambda>
+void find_if(Iterator first, Iterator last, Predicate pred,
+             Timestamp ts, CallBackLambda cb) {
+    if (first == last) {
+        swarm::enqueueLambda(cb, ts, EnqFlags::NOHINT, last);
+        return;
+    }
+    using Finder = swarm::_find::Finder<Iterator, Predicate, CallBackLambda>;
+    void* b = malloc(sizeof(Finder));
+    auto f = new(b) Finder(ts, cb, pred, first, last);
+    swarm::enqueueLambda(f, ts,
+                       {swarm::Hint::cacheLine(&(*first)), EnqFlags::MAYSPEC});
+}
+
+
+template <class Iterator, class Compare, class CallBackLambda>
+void min_element(Iterator first, Iterator last, Compare cmp,
+                 Timestamp ts, CallBackLambda cb) {
+    if (first == last) {
+        swarm::enqueueLambda(cb, ts, EnqFlags::NOHINT, last);
+        return;
+    }
+    using MinFinder =
+            swarm::_find::MinFinder<Iterator, Compare, CallBackLambda>;
+    void* b = malloc(sizeof(MinFinder));
+    auto m = new(b) MinFinder(ts, cb, cmp, first, last);
+    swarm::enqueueLambda(m, ts,
+                       {swarm::Hint::cacheLine(&(*first)), EnqFlags::MAYSPEC});
+}
+
+
+template <class Iterator, class CallBackLambda>
+void min_element(Iterator first, Iterator last, Timestamp ts,
+                 CallBackLambda cb) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    swarm::min_element(first, last,
+                       [] (const T& a, const T& b) { return a < b; }, ts, cb);
+}
+
+} // end namespace swarm
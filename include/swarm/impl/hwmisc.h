@@ -190,6 +190,8 @@ static void task_exception_handler() {
 }
 
 static void setup_task_handlers() {
+    __setup_spill_freelists();
+
     // Run a spiller that doesn't delete any tasks
     // 1) to avoid unused function warnings
     // 2) to pre-populate the global offset table with
@@ -211,6 +213,21 @@ static void setup_task_handlers() {
     sim_magic_op_2(MAGIC_OP_TASK_FRAMEHANDLER_ADDRS,
                    reinterpret_cast<uint64_t>(&swarm::frame_spiller),
                    frame_requeuer_ptr);
+
+#ifdef PLS_SINGLE_TASKFUNC
+    // Register the compact spiller for the app's single task function, so
+    // its tasks spill without the constant task pointer or unused arg slots
+    // (see spillers.h)
+    swarm::compact_spiller(0, 0);
+
+    uintptr_t compact_requeuer_ptr = reinterpret_cast<uintptr_t>(
+            bareRunner<decltype(swarm::compact_requeuer),
+                       swarm::compact_requeuer, CompactTaskDescriptors*>);
+    sim_magic_op_3(MAGIC_OP_REGISTER_SPILLER,
+                   __compactTaskPtr(),
+                   reinterpret_cast<uint64_t>(&swarm::compact_spiller),
+                   compact_requeuer_ptr);
+#endif
 }
 
 #ifdef SCC_RUNTIME
@@ -31,6 +31,7 @@
 #include <sstream>
 #include <tuple>
 #include <cstdlib>
+#include <new>
 
 #include "callfunc.h"
 // TODO(mcj) likely hooks should go in this directory. As a first step of
@@ -300,6 +301,53 @@ constexpr bool canCastArgs() {
     return (sizeof(T) > sizeof(uint64_t))? false : canCastArgs<i, Args...>();
 }
 
+/* Per-thread arena for spilled argument tuples.
+ *
+ * When a task's args don't fit in enqueue registers, __enqueueHwTask
+ * heap-allocates a tuple that memTupleRunner frees after the call.
+ * Lambda-heavy code (swarm::enqueueLambda with fat closures) takes this path
+ * on every enqueue, so at millions of enqueues per second general-purpose
+ * malloc/free dominates the profile. Instead, recycle fixed-size slots
+ * through per-thread freelists: each thread allocates from and frees to its
+ * own list, so no arena state is shared and speculative tasks cannot
+ * conflict on it. Enqueue and dequeue rates balance across threads over
+ * time, which keeps the lists populated; tuples larger than a slot fall
+ * back to the heap. Slabs are never returned, so the footprint is bounded
+ * by each thread's peak in-flight spilled tuples.
+ */
+constexpr size_t __tupleSlotBytes = 256;
+
+// [victory] C++17 would allow defining an inline thread_local variable in
+// this header file. But since we want to support older versions of GCC, lets
+// use the static-member-of-class-template trick. See: https://wg21.link/n4424
+template <typename T> struct __TupleArena {
+    static __thread void* head;  // free slots linked through their first word
+};
+template <typename T> __thread void* __TupleArena<T>::head;
+
+static inline void* __tupleSlotAlloc() {
+    void*& head = __TupleArena<int>::head;
+    if (pls_unlikely(!head)) {
+        constexpr size_t kSlotsPerSlab = 64;
+        char* slab = static_cast<char*>(
+                ::operator new(__tupleSlotBytes * kSlotsPerSlab));
+        for (size_t i = 0; i < kSlotsPerSlab; i++) {
+            void* slot = slab + i * __tupleSlotBytes;
+            *static_cast<void**>(slot) = head;
+            head = slot;
+        }
+    }
+    void* p = head;
+    head = *static_cast<void**>(p);
+    return p;
+}
+
+static inline void __tupleSlotFree(void* p) {
+    void*& head = __TupleArena<int>::head;
+    *static_cast<void**>(p) = head;
+    head = p;
+}
+
 /* Tuple-based calls */
 
 /* Bare runners: Simply undo casts. These often just compile to the function
@@ -388,7 +436,14 @@ template<typename F, F* f, typename... Args>
 inline void memTupleRunner(Timestamp ts, uint64_t t0) {
     auto tup = reinterpret_cast<std::tuple<Args...>*>(t0);
     callFunc(f, ts, *tup, typename gens<sizeof...(Args)>::type());
-    delete tup;
+    // Must mirror the allocation choice at the enqueue sites (below and in
+    // batch.h): slot-sized tuples recycle through the arena
+    if (sizeof(std::tuple<Args...>) <= __tupleSlotBytes) {
+        tup->~tuple();
+        __tupleSlotFree(tup);
+    } else {
+        delete tup;
+    }
 }
 
 /* Enqueue functions */
@@ -460,7 +515,11 @@ static inline void __enqueueHwTask(Timestamp ts, Hint hint, Args... args) {
 #pragma GCC diagnostic pop
 #endif
         } else {
-            auto tup = new std::tuple<Args...>(args...);
+            std::tuple<Args...>* tup;
+            if (sizeof(std::tuple<Args...>) <= __tupleSlotBytes)
+                tup = new (__tupleSlotAlloc()) std::tuple<Args...>(args...);
+            else
+                tup = new std::tuple<Args...>(args...);
             uint64_t magicOp = enqueueMagicOp(1, hint.flags);
             uintptr_t fp = reinterpret_cast<uintptr_t>(memTupleRunner<F, f, Args...>);
             __enqueue_task_skipargs(magicOp, fp, ts, hint.hint, reinterpret_cast<uintptr_t>(tup));
@@ -20,5 +20,13 @@
 #include <stdint.h>
 
 namespace swarm {
+    // Compile-time bound on children per task, sized for the task-argument
+    // and batching machinery. The enqueue-tree fanout enqueue_all actually
+    // uses is derived from the machine at startup and may exceed this; see
+    // __default_lg_fanout in impl/enqueue_all.h.
     static const uint32_t max_children = 8;
+
+    // Ceiling for the machine-derived fanout, bounding how many children a
+    // single enqueuer spawns on the largest configurations
+    static const uint32_t max_fanout = 4 * max_children;
 };
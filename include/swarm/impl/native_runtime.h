@@ -0,0 +1,308 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef FROM_PLS_API
+#error "This file cannot be included directly"
+#endif
+
+// Native ("competition") runtime: runs Swarm-API applications directly on
+// multicore x86 servers, with no simulator and no speculation. Each worker
+// thread owns a timestamp-ordered queue; spatial hints map tasks to workers,
+// and idle workers steal from the queue advertising the earliest timestamp.
+//
+// Without speculation we cannot give Swarm's sequential semantics in general.
+// Tasks commit non-speculatively as they run: each worker drains its queue in
+// nondecreasing timestamp order, which keeps execution approximately ordered
+// globally, and tasks enqueued with CANTSPEC are held back until their
+// timestamp matches a conservative global-minimum estimate (the native
+// analogue of running only at the GVT). Everything else is best-effort
+// priority order, as in conventional work-stealing baselines.
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+
+// Magic ops compile to xchg %rcx,%rcx, a no-op on real hardware, so headers
+// that reference the hooks (e.g. COMPILER_BARRIER) remain usable natively.
+#include "../hooks.h"
+#include "callfunc.h"
+
+namespace swarm {
+
+// Task representation. This mirrors swtasks.h's virtual Task, but the native
+// runtime keeps its own copy: the software-queue TaskPool and queues assume
+// races are resolved by simulator speculation, which does not hold here.
+struct NativeTask {
+    const Timestamp ts;
+    const EnqFlags flags;
+    NativeTask(Timestamp _ts, EnqFlags _flags) : ts(_ts), flags(_flags) {}
+    virtual ~NativeTask() = default;
+    virtual void call() = 0;
+};
+
+template <typename F, F* f, typename... Args>
+struct NativeTaskImpl : NativeTask {
+    const std::tuple<Args...> args;
+    NativeTaskImpl(Timestamp _ts, EnqFlags _flags, Args... _args)
+        : NativeTask(_ts, _flags), args(_args...) {}
+    void call() override {
+        callFunc(f, ts, args, typename gens<sizeof...(Args)>::type());
+    }
+};
+
+struct __CompareNativeTasks {
+    bool operator()(const NativeTask* a, const NativeTask* b) const {
+        return a->ts > b->ts;
+    }
+};
+
+class alignas(SWARM_CACHE_LINE) NativeWorker {
+    using PQ = std::priority_queue<NativeTask*, std::vector<NativeTask*>,
+                                   __CompareNativeTasks>;
+    std::mutex lock;
+    PQ pq;
+
+  public:
+    // Earliest queued timestamp, refreshed under the lock on push/pop so that
+    // steal victims and the global-minimum estimate can be chosen without
+    // taking every queue's lock.
+    std::atomic<Timestamp> queueMin{UINT64_MAX};
+    // Timestamp of the task this worker is currently running (UINT64_MAX when
+    // idle); part of the conservative global-minimum estimate.
+    std::atomic<Timestamp> runningTs{UINT64_MAX};
+
+    void push(NativeTask* t) {
+        std::lock_guard<std::mutex> guard(lock);
+        pq.push(t);
+        if (t->ts < queueMin.load(std::memory_order_relaxed))
+            queueMin.store(t->ts, std::memory_order_relaxed);
+    }
+
+    NativeTask* pop() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (pq.empty()) return nullptr;
+        NativeTask* t = pq.top();
+        pq.pop();
+        queueMin.store(pq.empty() ? UINT64_MAX : pq.top()->ts,
+                       std::memory_order_relaxed);
+        return t;
+    }
+};
+
+// [victory] C++17 would allow defining inline variables in this header file.
+// But since we want to support older versions of GCC, lets use the
+// static-member-of-class-template trick.  See: https://wg21.link/n4424
+template <typename T> struct __NativeRuntimeState {
+    static NativeWorker* workers;
+    static uint32_t nthreads;
+    static std::atomic<uint64_t> tasksOutstanding;
+    static thread_local uint32_t threadId;
+    static thread_local Timestamp curTs;
+    static thread_local uint64_t rngState;
+};
+template <typename T> NativeWorker* __NativeRuntimeState<T>::workers = nullptr;
+template <typename T> uint32_t __NativeRuntimeState<T>::nthreads = 0;
+template <typename T> std::atomic<uint64_t> __NativeRuntimeState<T>::tasksOutstanding{0};
+template <typename T> thread_local uint32_t __NativeRuntimeState<T>::threadId = 0;
+template <typename T> thread_local Timestamp __NativeRuntimeState<T>::curTs = UINT64_MAX;
+template <typename T> thread_local uint64_t __NativeRuntimeState<T>::rngState = 0x9e3779b97f4a7c15ul;
+using __NRS = __NativeRuntimeState<int>;
+
+static inline uint32_t num_threads() {
+    if (!__NRS::nthreads) {
+        const char* env = getenv("SWARM_NUM_THREADS");
+        long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+        __NRS::nthreads = (n > 0) ? n : 1;
+    }
+    return __NRS::nthreads;
+}
+// Without tiles, treat each core as its own task unit, so NOHASH tile hints
+// (e.g. from tileId()) keep their stay-local meaning.
+static inline uint32_t numTiles() { return num_threads(); }
+static inline uint32_t tid() { return __NRS::threadId; }
+static inline uint32_t tileId() { return __NRS::threadId; }
+
+static inline void info(const char* str) {
+    puts(str);
+}
+
+template <typename... Args>
+static inline void info(const char* str, Args... args) {
+    printf(str, args...);
+    printf("\n");
+}
+
+// Conservative lower bound on any unfinished task's timestamp.
+static inline Timestamp __nativeGvtEstimate() {
+    Timestamp min = UINT64_MAX;
+    for (uint32_t i = 0; i < num_threads(); i++) {
+        min = std::min(min, __NRS::workers[i].queueMin.load(
+                                std::memory_order_relaxed));
+        min = std::min(min, __NRS::workers[i].runningTs.load(
+                                std::memory_order_relaxed));
+    }
+    return min;
+}
+
+static inline uint32_t __nativeQueueOf(Timestamp ts, Hint hint) {
+    uint32_t n = num_threads();
+    if (hint.flags & (EnqFlags::SAMEHINT)) return tid();
+    if (hint.flags & EnqFlags::NOHINT) {
+        // No placement preference: spread via a cheap thread-local xorshift.
+        uint64_t& x = __NRS::rngState;
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        return x % n;
+    }
+    if (hint.flags & EnqFlags::NOHASH) return hint.hint % n;
+    // Hashed hint: finalizer from MurmurHash3, good enough to decluster
+    // adjacent hints.
+    uint64_t h = hint.hint;
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdul;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ul;
+    h ^= h >> 33;
+    return h % n;
+}
+
+template<typename F, F* f, typename... Args>
+void enqueueTask(Timestamp ts, Hint hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    EnqFlags flags = hint.flags;
+    if (flags & EnqFlags::SAMETIME) ts = __NRS::curTs;
+    __NRS::tasksOutstanding.fetch_add(1, std::memory_order_relaxed);
+    auto* t = new NativeTaskImpl<F, f, Args...>(ts, flags, args...);
+    __NRS::workers[__nativeQueueOf(ts, hint)].push(t);
+}
+
+static inline void __nativeRunTask(NativeWorker& me, NativeTask* t) {
+    me.runningTs.store(t->ts, std::memory_order_relaxed);
+    __NRS::curTs = t->ts;
+    t->call();
+    __NRS::curTs = UINT64_MAX;
+    me.runningTs.store(UINT64_MAX, std::memory_order_relaxed);
+    delete t;
+    __NRS::tasksOutstanding.fetch_sub(1, std::memory_order_release);
+}
+
+static inline void __nativeWorkerLoop(uint32_t id) {
+    __NRS::threadId = id;
+    NativeWorker& me = __NRS::workers[id];
+
+    while (__NRS::tasksOutstanding.load(std::memory_order_acquire)) {
+        NativeTask* t = me.pop();
+        if (!t) {
+            // Timestamp-aware steal: victimize the queue advertising the
+            // earliest task, keeping execution close to timestamp order.
+            uint32_t victim = UINT32_MAX;
+            Timestamp best = UINT64_MAX;
+            for (uint32_t i = 0; i < num_threads(); i++) {
+                Timestamp m = __NRS::workers[i].queueMin.load(
+                        std::memory_order_relaxed);
+                if (m < best) { best = m; victim = i; }
+            }
+            if (victim != UINT32_MAX) t = __NRS::workers[victim].pop();
+            if (!t) {
+                sched_yield();
+                continue;
+            }
+        }
+        if ((t->flags & EnqFlags::CANTSPEC) && t->ts > __nativeGvtEstimate()) {
+            // Ordered commit required: hold the task until its timestamp is
+            // the global minimum, i.e., everything earlier has committed.
+            me.push(t);
+            sched_yield();
+            continue;
+        }
+        __nativeRunTask(me, t);
+    }
+}
+
+static void* __nativeWorkerMain(void* arg) {
+    __nativeWorkerLoop(static_cast<uint32_t>(
+            reinterpret_cast<uintptr_t>(arg)));
+    return nullptr;
+}
+
+static inline void run() {
+    uint32_t n = num_threads();
+    assert(__NRS::workers);  // created by the first enqueue
+
+    std::vector<pthread_t> threads(n);
+    for (uint32_t t = 1; t < n; t++) {
+        int err = pthread_create(&threads[t], nullptr, __nativeWorkerMain,
+                reinterpret_cast<void*>(static_cast<uintptr_t>(t)));
+        if (err != 0) std::abort();
+    }
+    __nativeWorkerLoop(0);
+    for (uint32_t t = 1; t < n; t++) {
+        int err = pthread_join(threads[t], nullptr);
+        if (err != 0) std::abort();
+    }
+}
+
+// Tasks are irrevocable here, so a task is trivially "the GVT task" in the
+// sense that nothing can abort it.
+static inline void serialize() {}
+static inline void setGvt(Timestamp) {}
+static inline void clearReadSet() {}
+static inline void recordAsAborted() {}
+static inline void deepen(uint64_t) {
+    swarm::info("swarm::deepen() unimplemented in the native runtime");
+    std::abort();
+}
+static inline void undeepen() {
+    swarm::info("swarm::undeepen() unimplemented in the native runtime");
+    std::abort();
+}
+static inline Timestamp timestamp() { return __NRS::curTs; }
+static inline Timestamp superTimestamp() { return UINT64_MAX; }
+
+static inline void mallocPartition(void*, void*, uint64_t) {}
+
+// Allocate the worker queues before main() runs, so root enqueues work.
+// (A static member of a class template would be discarded as unused; an
+// ordinary static in this header is referenced by its initializer only.)
+struct __NativeWorkersInit {
+    __NativeWorkersInit() {
+        uint32_t n = num_threads();
+        void* b = nullptr;
+        int err = posix_memalign(&b, SWARM_CACHE_LINE,
+                                 n * sizeof(NativeWorker));
+        if (err != 0) std::abort();
+        __NRS::workers = static_cast<NativeWorker*>(b);
+        for (uint32_t i = 0; i < n; i++) new (&__NRS::workers[i]) NativeWorker();
+    }
+};
+template <typename T> struct __NativeWorkersInitHolder {
+    static __NativeWorkersInit init;
+};
+template <typename T> __NativeWorkersInit __NativeWorkersInitHolder<T>::init;
+static __NativeWorkersInit& __nativeWorkersInit = __NativeWorkersInitHolder<int>::init;
+
+}  // namespace swarm
@@ -0,0 +1,144 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#pragma once
+
+#ifndef FROM_PLS_API
+#error "This file cannot be included directly"
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#ifdef PLS_ORACLE_ARENA_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace swarm {
+
+// Chunked arena for the oracle runtime's Task objects. The oracle keeps every
+// pending task live as a heap-allocated virtual Task, and domains' queues only
+// drain when the domain pops, so billion-task traces exhaust memory on
+// per-task heap overhead long before the region of interest. Instead, bump-
+// allocate Tasks out of large chunks, one chunk list per live domain (parallel
+// to the pqs stack in oracle_tasks.h): individual frees become no-ops, and a
+// domain's chunks are reclaimed wholesale when runloop pops its queue.
+// Reclaimed chunks are recycled through a freelist, so like TaskPool the
+// footprint is bounded by the peak of live tasks, not the total enqueued.
+//
+// Define PLS_ORACLE_ARENA_MMAP to back chunks with a memory-mapped unlinked
+// temporary file instead of malloc. File-backed pages are evictable without
+// swap, so chunks holding cold, far-future tasks (written at enqueue, next
+// touched at dequeue) page out to disk under memory pressure while the chunks
+// near the head of the queues stay resident.
+class OracleArena {
+    static constexpr size_t kChunkBytes = 1ul << 20;
+    static constexpr size_t kGranularity = 16;  // matches TaskPool
+
+    struct Chunk {
+        Chunk* next;
+        size_t used;  // bytes consumed, including this header
+    };
+
+    std::vector<Chunk*> domains;  // chunk list per live domain
+    Chunk* freeChunks = nullptr;
+#ifdef PLS_ORACLE_ARENA_MMAP
+    int fd = -1;
+    size_t fileBytes = 0;
+#endif
+
+    Chunk* newChunk();
+
+  public:
+    // Keep the domain stack in sync with pqs: push on deepen (and the
+    // bootstrap enqueue), pop when runloop discards a domain's queue.
+    inline void push() { domains.push_back(nullptr); }
+
+    inline void pop() {
+        Chunk* c = domains.back();
+        domains.pop_back();
+        while (c) {
+            Chunk* next = c->next;
+            c->next = freeChunks;
+            freeChunks = c;
+            c = next;
+        }
+    }
+
+    // Allocate into the domain at the given depth in the pqs stack; tasks
+    // enqueued with PARENTDOMAIN must land in the parent's chunks so they
+    // outlive the enqueuing domain.
+    inline void* alloc(size_t depth, size_t bytes) {
+        bytes = (bytes + kGranularity - 1) & ~(kGranularity - 1);
+        assert(bytes <= kChunkBytes - sizeof(Chunk));
+        assert(depth < domains.size());
+        Chunk*& head = domains[depth];
+        if (pls_unlikely(!head || head->used + bytes > kChunkBytes)) {
+            Chunk* c = newChunk();
+            c->next = head;
+            head = c;
+        }
+        void* p = reinterpret_cast<char*>(head) + head->used;
+        head->used += bytes;
+        return p;
+    }
+};
+
+inline OracleArena::Chunk* OracleArena::newChunk() {
+    if (freeChunks) {
+        Chunk* c = freeChunks;
+        freeChunks = c->next;
+        c->next = nullptr;
+        c->used = kGranularity;  // sizeof(Chunk) rounded up
+        return c;
+    }
+#ifdef PLS_ORACLE_ARENA_MMAP
+    if (fd < 0) {
+        char path[] = "/tmp/swarm-oracle-arena-XXXXXX";
+        fd = mkstemp(path);
+        assert(fd >= 0);
+        unlink(path);  // deleted on exit; pages live on while mapped
+    }
+    int err = ftruncate(fd, fileBytes + kChunkBytes);
+    assert(!err); (void)err;
+    void* mem = mmap(nullptr, kChunkBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, fileBytes);
+    assert(mem != MAP_FAILED);
+    fileBytes += kChunkBytes;
+#else
+    void* mem = malloc(kChunkBytes);
+    assert(mem);
+#endif
+    Chunk* c = static_cast<Chunk*>(mem);
+    c->next = nullptr;
+    c->used = kGranularity;
+    return c;
+}
+
+// [victory] C++17 would allow defining an inline variable in this header file.
+// But since we want to support older versions of GCC, lets use the
+// static-member-of-class-template trick.  See: https://wg21.link/n4424
+template <typename T> struct __OracleArenaState {
+  static OracleArena arena;
+};
+template <typename T> OracleArena __OracleArenaState<T>::arena;
+static OracleArena& taskArena = __OracleArenaState<int>::arena;
+
+}
@@ -0,0 +1,169 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#pragma once
+
+#ifndef FROM_PLS_API
+#error "This file cannot be included directly"
+#endif
+
+/* In-runtime parallelism profiling for the oracle runtime. Define
+ * PLS_ORACLE_PROFILE to get a parallelism profile when the runloop drains,
+ * without replaying the task-graph trace through the simulator. When it is
+ * not defined, all hooks compile away.
+ *
+ * The runloop runs tasks one at a time, so per-task work is measured with
+ * rdtsc and the spawn graph (recorded at enqueue, where the task function is
+ * statically known) yields a critical path: cp(task) = work(task) +
+ * cp(spawner). This covers spawn dependences only -- data dependences
+ * between timestamp-ordered tasks need the simulator's read/write tracking
+ * -- so the reported critical path is a lower bound and the available
+ * parallelism an upper bound. That is the right direction for triage: a
+ * scaling problem visible here is real.
+ *
+ * The report prints total work and parallelism, work and parallelism per
+ * timestamp bucket (timestamps from nested domains are mixed into the same
+ * scale), and the task functions with the most work on the critical path.
+ * Functions are reported by address, as in taskstats.h; map them to names
+ * with nm or addr2line. The profiler keeps one 40-byte record per task.
+ */
+#ifdef PLS_ORACLE_PROFILE
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <x86intrin.h>
+
+namespace swarm {
+
+struct OracleProfiler {
+    struct TaskRec {
+        uint64_t parent;
+        uintptr_t fp;
+        Timestamp ts;
+        uint64_t work;
+        uint64_t cp;  // critical path through spawn dependences, ending here
+    };
+
+    std::vector<TaskRec> tasks;  // indexed by uid; uids are dense
+    uint64_t beginCycle = 0;
+    uint64_t totalWork = 0;
+    uint64_t critTask = 0;
+
+    void create(uint64_t uid, uint64_t parent, Timestamp ts, uintptr_t fp) {
+        assert(uid == tasks.size());
+        tasks.push_back({parent, fp, ts, 0ul, 0ul});
+    }
+
+    void begin() { beginCycle = __rdtsc(); }
+
+    // The serial runloop finishes a spawner before dequeuing any of its
+    // children, so the parent's cp is final by the time a child ends
+    void end(uint64_t uid) {
+        TaskRec& t = tasks[uid];
+        t.work = __rdtsc() - beginCycle;
+        totalWork += t.work;
+        t.cp = t.work + tasks[t.parent].cp;
+        if (t.cp > tasks[critTask].cp) critTask = uid;
+    }
+
+    void report() const {
+        if (tasks.empty()) return;
+        const uint64_t cp = std::max(tasks[critTask].cp, 1ul);
+        printf("[ORACLE-PROFILE] %lu tasks, work %lu cycles, "
+               "spawn critical path %lu cycles, available parallelism %.1f\n",
+               tasks.size(), totalWork, cp,
+               static_cast<double>(totalWork) / cp);
+
+        // Parallelism vs. timestamp, over the observed range
+        constexpr uint32_t kBuckets = 32;
+        Timestamp minTs = UINT64_MAX, maxTs = 0;
+        for (const TaskRec& t : tasks) {
+            if (!t.work) continue;  // e.g. the synthetic root
+            minTs = std::min(minTs, t.ts);
+            maxTs = std::max(maxTs, t.ts);
+        }
+        if (minTs > maxTs) return;
+        const uint64_t width = (maxTs - minTs) / kBuckets + 1;
+        uint64_t work[kBuckets] = {}, crit[kBuckets] = {}, cnt[kBuckets] = {};
+        for (const TaskRec& t : tasks) {
+            uint32_t b = (t.ts - minTs) / width;
+            work[b] += t.work;
+            cnt[b]++;
+        }
+        // Attribute critical-path work by walking the spawn chain back from
+        // the argmax task; every chain terminates at the root (uid 0)
+        for (uint64_t u = critTask; u; u = tasks[u].parent)
+            crit[(tasks[u].ts - minTs) / width] += tasks[u].work;
+
+        printf("[ORACLE-PROFILE] %20s %10s %14s %14s %12s\n",
+               "timestamp", "tasks", "work", "crit work", "parallelism");
+        for (uint32_t b = 0; b < kBuckets; b++) {
+            if (!cnt[b]) continue;
+            printf("[ORACLE-PROFILE] %20lu %10lu %14lu %14lu %12.1f\n",
+                   minTs + b * width, cnt[b], work[b], crit[b],
+                   static_cast<double>(work[b]) / std::max(crit[b], 1ul));
+        }
+
+        // Top serializing task functions: work on the critical path
+        struct FnRow { uintptr_t fp; uint64_t tasks, work, critWork; };
+        std::vector<FnRow> rows;
+        auto rowFor = [&rows] (uintptr_t fp) -> FnRow& {
+            for (FnRow& r : rows) if (r.fp == fp) return r;
+            rows.push_back({fp, 0ul, 0ul, 0ul});
+            return rows.back();
+        };
+        for (const TaskRec& t : tasks) {
+            FnRow& r = rowFor(t.fp);
+            r.tasks++;
+            r.work += t.work;
+        }
+        for (uint64_t u = critTask; u; u = tasks[u].parent)
+            rowFor(tasks[u].fp).critWork += tasks[u].work;
+        std::sort(rows.begin(), rows.end(), [] (const FnRow& a, const FnRow& b) {
+            return a.critWork > b.critWork;
+        });
+
+        printf("[ORACLE-PROFILE] Top serializing taskfns "
+               "(map fps with nm/addr2line):\n");
+        printf("[ORACLE-PROFILE] %18s %12s %14s %14s %8s\n",
+               "taskfn", "tasks", "work", "crit work", "cp%");
+        uint32_t printed = 0;
+        for (const FnRow& r : rows) {
+            if (!r.critWork || printed++ == 10) break;
+            printf("[ORACLE-PROFILE] 0x%016lx %12lu %14lu %14lu %7.1f%%\n",
+                   r.fp, r.tasks, r.work, r.critWork,
+                   100.0 * static_cast<double>(r.critWork) / cp);
+        }
+        fflush(stdout);
+    }
+};
+
+// [victory] C++17 would allow defining an inline variable in this header
+// file. But since we want to support older versions of GCC, lets use the
+// static-member-of-class-template trick. See: https://wg21.link/n4424
+template <typename T> struct __OracleProfilerState {
+    static OracleProfiler profiler;
+};
+template <typename T> OracleProfiler __OracleProfilerState<T>::profiler;
+static OracleProfiler& __oracleProfiler = __OracleProfilerState<int>::profiler;
+
+}  // namespace swarm
+
+#endif  // PLS_ORACLE_PROFILE
@@ -36,6 +36,7 @@
 
 #define SWTASKS_USE_UID
 #include "oracle_tasks.h"
+#include "oracle_profiler.h"
 
 namespace swarm {
 
@@ -75,12 +76,20 @@ static inline void runloop() {
     swarm::info("&curTaskTS:     %p", &curTaskTS);
     while (!pqs.empty()) {
         while (!pqs.top()->empty()) {
-#ifndef PLS_SINGLE_TASKFUNC
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
             TaskState* t = pqs.top()->dequeueTop();
             curTaskId = t->uid;
             curTaskTS = t->ts;
+#ifdef PLS_ORACLE_PROFILE
+            __oracleProfiler.begin();
+#endif
             t->call();
-            delete t;
+#ifdef PLS_ORACLE_PROFILE
+            __oracleProfiler.end(t->uid);
+#endif
+            // Just run the destructor: the memory belongs to the arena and is
+            // reclaimed in whole chunks when this domain pops below.
+            t->~TaskState();
 #else
             auto args = pqs.top()->dequeueTop();
             curTaskId = std::get<0>(args);
@@ -88,13 +97,20 @@ static inline void runloop() {
             // Avoid adding curTaskId to the readset of the task
             const uint64_t tid = curTaskId;
             sim_task_begin(tid);
-            callFuncTupleIgnoringFirstArg(PLS_SINGLE_TASKFUNC, args);
+#ifdef PLS_ORACLE_PROFILE
+            __oracleProfiler.begin();
+#endif
+            __callTaskArgs(args);
+#ifdef PLS_ORACLE_PROFILE
+            __oracleProfiler.end(tid);
+#endif
             sim_task_end(tid);
 #endif
         }
         PriorityQueue* pq = pqs.top();
         pqs.pop();
         delete pq;
+        taskArena.pop();
         superTsStack.pop();
         sim_magic_op_0(SIM_TASK_UNDEEPEN);
     }
@@ -113,6 +129,10 @@ static inline void run() {
     makecontext(&workerContext, (void (*)())runloop, 0);
     int err = swapcontext(&returnContext, &workerContext);
     assert(!err); (void) err;
+#ifdef PLS_ORACLE_PROFILE
+    // Back on the original stack, where stdio works (see info below)
+    __oracleProfiler.report();
+#endif
 }
 
 static inline void info(const char* str) {
@@ -145,17 +165,25 @@ void enqueueTask(Timestamp ts, Hint hint, Args... args) {
         curTaskId = 0;
         assert(pqs.empty());
         pqs.push(new swarm::PriorityQueue());
+        taskArena.push();
         superTsStack.push(UINT64_MAX);
         sim_resume_recording();
         sim_task_create(0,0,0,0,0,0);
         sim_task_begin(0);
         sim_task_end(0);
         sim_stop_recording();
+#ifdef PLS_ORACLE_PROFILE
+        __oracleProfiler.create(0, 0, 0, 0);
+#endif
     }
 
     uint64_t newTaskId = ++taskIdCounter;
     size_t nargs = sizeof...(args);
     sim_task_create(curTaskId, newTaskId, ts, (uint64_t) hint.flags, hint.hint, nargs);
+#ifdef PLS_ORACLE_PROFILE
+    __oracleProfiler.create(newTaskId, curTaskId, ts,
+                            reinterpret_cast<uintptr_t>(f));
+#endif
     __enqueueSwTask<F, f, Args...>(newTaskId, ts, hint, args...);
     sim_resume_recording();
 }
@@ -168,6 +196,7 @@ static inline void deepen(uint64_t maxTS) {
     // but we currently ignore maxTS settings in ordspecsim.
     if (maxTS != -1ul) swarm::info("WARN: maxTS: %lu != -1 used, ignoring...", maxTS);
     pqs.push(new swarm::PriorityQueue());
+    taskArena.push();
     superTsStack.push(curTaskTS);
     sim_magic_op_1(SIM_TASK_DEEPEN, curTaskId);
     sim_resume_recording();
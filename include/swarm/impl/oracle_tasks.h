@@ -24,6 +24,9 @@
 
 #include <stack>
 #include "swtasks.h"
+#ifdef SWTASKS_USE_UID
+#include "oracle_arena.h"
+#endif
 
 namespace swarm {
 
@@ -44,7 +47,7 @@ template <typename T> struct __OracleTasks {
 template <typename T> std::stack<swarm::PriorityQueue*> __OracleTasks<T>::pqs;
 static std::stack<swarm::PriorityQueue*>& pqs = __OracleTasks<int>::pqs;
 
-#ifndef PLS_SINGLE_TASKFUNC
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
 
 template<typename F, F* f, typename... Args>
 #ifdef SWTASKS_USE_UID
@@ -69,14 +72,17 @@ void __enqueueSwTask(Timestamp ts, Hint hint, Args... args) {
     } else pqToEnqueueTask = pqs.top();
 
 #ifdef SWTASKS_USE_UID
-    pqToEnqueueTask->push(new Task<F, f, Args...>(uid, ts, args...));
+    // Place the Task into the target domain's arena chunks (any PARENTDOMAIN
+    // pop above already happened, so the target is the top of the stack).
+    void* mem = taskArena.alloc(pqs.size() - 1, sizeof(Task<F, f, Args...>));
+    pqToEnqueueTask->push(new (mem) Task<F, f, Args...>(uid, ts, args...));
 #else
     pqToEnqueueTask->push(new Task<F, f, Args...>(ts, args...));
 #endif
     if (childPq) pqs.push(childPq);
 }
 
-#else
+#elif defined(PLS_SINGLE_TASKFUNC)
 
 #ifndef SWTASKS_USE_UID
 template<typename F, F* f, typename... Args>
@@ -94,6 +100,30 @@ void __enqueueSwTask(uint64_t uid, Timestamp ts, Hint hint, Args... args) {
 }
 #endif
 
+#else  // PLS_TASKFUNC_REGISTRY
+
+#ifndef SWTASKS_USE_UID
+template<typename F, F* f, typename... Args>
+void __enqueueSwTask(Timestamp ts, Hint hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    pqs.top()->push(TaskArgs(__RegistryIndexOf<F, f>::value, ts, args...));
+}
+#else
+template<typename F, F* f, typename... Args>
+void __enqueueSwTask(uint64_t uid, Timestamp ts, Hint hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    pqs.top()->push(TaskArgs(uid, __RegistryIndexOf<F, f>::value, ts, args...));
+}
+#endif
+
 #endif
 
 }
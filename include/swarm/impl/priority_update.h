@@ -0,0 +1,77 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#include <cstdint>
+#include "../algorithm.h"
+#include "../api.h"
+
+namespace swarm {
+
+template <typename T, typename Compare>
+static inline void priority_update(T* addr, T value, Compare cmp,
+                                   Timestamp ts) {
+    swarm::enqueueLambda([addr, value, cmp] (swarm::Timestamp) {
+        // Read first and return without writing when the update loses: an
+        // empty write-set makes the task cheap to abort, and same-line
+        // readers can commit around it
+        if (cmp(value, *addr)) *addr = value;
+    }, ts, {Hint::cacheLine(addr), EnqFlags::MAYSPEC});
+}
+
+template <typename Iterator, typename Compare>
+static inline void priority_update_all(Iterator first, Iterator last,
+                                       Compare cmp, Timestamp ts) {
+    // Each enqueuer-tree leaf takes a chunk of update records and enqueues
+    // one task per distinct cache line in its chunk; that task applies all of
+    // the chunk's updates to its line, so line-local updates from one
+    // expansion share a single hinted task instead of going task-by-task
+    // through the line's serializing hint.
+    constexpr uint64_t kChunk = 8;
+    const uint64_t n = last - first;
+    if (!n) return;
+    const uint64_t nchunks = (n + kChunk - 1) / kChunk;
+
+    swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC)>(u64it(0), u64it(nchunks),
+            [first, n, cmp] (swarm::Timestamp ts, uint64_t c) {
+        Iterator cf = first + c * kChunk;
+        uint64_t cn = n - c * kChunk;
+        if (cn > kChunk) cn = kChunk;
+        for (uint64_t i = 0; i < cn; i++) {
+            const uint64_t line = Hint::cacheLine((cf + i)->first);
+            // Only the first record of each line spawns the line's task
+            bool seen = false;
+            for (uint64_t j = 0; j < i; j++) {
+                if (Hint::cacheLine((cf + j)->first) == line) {
+                    seen = true;
+                    break;
+                }
+            }
+            if (seen) continue;
+            swarm::enqueueLambda([cf, cn, line, cmp] (swarm::Timestamp) {
+                for (uint64_t j = 0; j < cn; j++) {
+                    auto* addr = (cf + j)->first;
+                    if (Hint::cacheLine(addr) != line) continue;
+                    const auto value = (cf + j)->second;
+                    if (cmp(value, *addr)) *addr = value;
+                }
+            }, ts, {line, EnqFlags::MAYSPEC});
+        }
+    }, ts);
+}
+
+}
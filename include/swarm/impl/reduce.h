@@ -32,7 +32,11 @@
 namespace swarm {
 namespace _reduce {
 
-template <class Iterator, class T, class BinaryOp,
+// o folds elements into an accumulator (like std::accumulate); c combines two
+// already-folded partials. They differ when the reduction transforms its
+// input, e.g. summing popcounts of words: o adds a word's popcount to a
+// count, c adds two counts. For plain reductions c == o.
+template <class Iterator, class T, class BinaryOp, class CombineOp,
           class CallBackLambda, class CallBackHintLambda>
 struct Reducer {
     static const uint32_t size;
@@ -42,6 +46,7 @@ struct Reducer {
     CallBackHintLambda cbhint;
 
     BinaryOp o;
+    CombineOp c;
     T identity;
     Iterator first;
     Iterator last;
@@ -49,12 +54,13 @@ struct Reducer {
     swarm::aligned<T> intermediates[0];
 
     Reducer(swarm::Timestamp ts, CallBackLambda _cb, CallBackHintLambda _cbh,
-            BinaryOp _o, T i,
+            BinaryOp _o, CombineOp _c, T i,
             Iterator _first, Iterator _last)
         : cbts(ts)
         , cb(_cb)
         , cbhint(_cbh)
         , o(_o)
+        , c(_c)
         , identity(i)
         , first(_first)
         , last(_last)
@@ -109,8 +115,12 @@ struct Reducer {
             Iterator begin,
             Iterator end) {
         T value = std::accumulate(begin, end, r->identity, r->o);
+        // Fold the partial into this tile's slot. With SAMEHINT the update
+        // inherited the data line's hint, so a thread on tile A often
+        // updated an intermediate whose line last lived on tile B, bouncing
+        // partial-sum lines across tiles for the whole reduction.
         swarm::enqueue(updateIntermediate,
-                     ts, EnqFlags(SAMEHINT | MAYSPEC),
+                     ts, {swarm::tileId(), EnqFlags(NOHASH | MAYSPEC)},
                      r, value);
     }
 
@@ -120,17 +130,19 @@ struct Reducer {
     }
 
 
+    // Updates sharing a tile conflict on the slot, but they are MAYSPEC
+    // tasks, so the hardware serializes them; in the software runtimes the
+    // tile-to-thread mapping keeps each slot single-writer
     static void updateIntermediate(swarm::Timestamp, Reducer* r, T value) {
-        //swarm::info("tid %ld", swarm::tid());
-        auto* intermediate = &r->intermediates[swarm::tid()];
-        *intermediate = r->o(*intermediate, value);
+        auto* intermediate = &r->intermediates[swarm::tileId() % Reducer::size];
+        *intermediate = r->c(*intermediate, value);
     }
 
 
     static void collapse(swarm::Timestamp, Reducer* r) {
         auto* begin = &r->intermediates[0];
         auto* end = &r->intermediates[Reducer::size];
-        BinaryOp o = r->o;
+        CombineOp o = r->c;
 
         // Force 12 in-flight loads to exploits MLP since most loads will miss.
         // The alternative (see the epilog below) compiles the loop such that
@@ -182,15 +194,21 @@ struct Reducer {
 };
 
 
-template <class It, class T, class BinaryOp, class CB, class CBH>
-const uint32_t Reducer<It, T, BinaryOp, CB, CBH>::size = swarm::num_threads();
+// One intermediate per tile, not per thread: a slot's line then stays
+// resident in its tile's cache for the whole reduction, and collapse walks
+// numTiles() lines instead of num_threads(). (The oracle runtime reports an
+// absurd tile count, so cap at the thread count.)
+template <class It, class T, class BinaryOp, class CombineOp,
+          class CB, class CBH>
+const uint32_t Reducer<It, T, BinaryOp, CombineOp, CB, CBH>::size =
+        std::min(swarm::numTiles(), swarm::num_threads());
 
 
 } // end namespace _reduce
 
 
 /**
- * Create a task that performs a parallel reduction into per-thread intermediate
+ * Create a task that performs a parallel reduction into per-tile intermediate
  * variables, then collapses those intermediates and calls your callback.
  *
  * TODO(mcj)
@@ -198,22 +216,31 @@ const uint32_t Reducer<It, T, BinaryOp, CB, CBH>::size = swarm::num_threads();
  * willing to accept that the callback is created as a new task, using the
  * reduction result?
  */
-template <class Iterator, class T, class BinaryOp, class CallBackLambda>
-void reduce(Iterator first, Iterator last, T identity, BinaryOp o, Timestamp ts,
-            CallBackLambda cb) {
+template <class Iterator, class T, class BinaryOp, class CombineOp,
+          class CallBackLambda>
+void reduce(Iterator first, Iterator last, T identity, BinaryOp o, CombineOp c,
+            Timestamp ts, CallBackLambda cb) {
     // TODO(mcj) offer a callback timestamp and callback hint to the API
     auto cbh = [] (typename std::iterator_traits<Iterator>::reference) {
         return swarm::Hint(EnqFlags::NOHINT);
     };
 
-    using Reducer = swarm::_reduce::Reducer<Iterator, T, BinaryOp,
+    using Reducer = swarm::_reduce::Reducer<Iterator, T, BinaryOp, CombineOp,
                                           CallBackLambda, decltype(cbh)>;
     void* b = malloc(sizeof(Reducer) + SWARM_CACHE_LINE * Reducer::size);
-    auto r = new(b) Reducer(ts, cb, cbh, o, identity, first, last);
+    auto r = new(b) Reducer(ts, cb, cbh, o, c, identity, first, last);
     // FIXME(mcj) MAYSPEC isn't necessarily safe. The caller should be able to
     // express it.
     swarm::enqueueLambda(r, ts,
                        {swarm::Hint::cacheLine(&(*first)), EnqFlags::MAYSPEC});
 }
 
+
+template <class Iterator, class T, class BinaryOp, class CallBackLambda>
+void reduce(Iterator first, Iterator last, T identity, BinaryOp o, Timestamp ts,
+            CallBackLambda cb) {
+    // An ordinary reduction combines partials with the same operator
+    swarm::reduce(first, last, identity, o, o, ts, cb);
+}
+
 } // end namespace swarm
@@ -0,0 +1,222 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+#include "../api.h"
+#include "../algorithm.h"
+#include "../aligned.h"
+#include "block.h"
+
+
+namespace swarm {
+namespace _scan {
+
+// The classic two-pass block scan, structured like _reduce::Reducer: the
+// caller's enqueue makes the scan appear atomic at one timestamp, and the
+// Scanner deepens into a subdomain whose timestamps separate the phases.
+// Timestamp 0 reduces each block into its cache-line-aligned slot of
+// blockSums (the upsweep); timestamp 1 serially scans the block sums --
+// there are only ~4 per thread, so a task per sum would be overhead --
+// leaving each block's exclusive prefix in its slot; timestamp 2 re-walks
+// each block seeded with that prefix and writes the outputs (the
+// downsweep); timestamp 3 enqueues the callback, which receives the total,
+// in the parent domain.
+template <bool Inclusive, class InputIt, class OutputIt, class T,
+          class BinaryOp, class CallBackLambda>
+struct Scanner {
+    swarm::Timestamp cbts;
+    CallBackLambda cb;
+    BinaryOp o;
+    T init;  // unused for inclusive scans
+    T total;
+    InputIt ifirst;
+    OutputIt dfirst;
+    uint64_t n;
+    uint64_t blockElems;
+    uint64_t numBlocks;
+    swarm::aligned<T> blockSums[0];
+
+    // Callers need the block count to size the allocation; grainSize already
+    // targets ~4 blocks per thread in whole aligned cache lines
+    static uint64_t chooseBlockElems(InputIt first, InputIt last) {
+        return std::max(
+                swarm::block::elementsPerLine<InputIt>(),
+                static_cast<uint64_t>(swarm::block::grainSize(first, last)) *
+                        SWARM_CACHE_LINE / sizeof(T));
+    }
+
+    Scanner(swarm::Timestamp ts, CallBackLambda _cb, BinaryOp _o, T _init,
+            InputIt _ifirst, InputIt ilast, OutputIt _dfirst)
+        : cbts(ts)
+        , cb(_cb)
+        , o(_o)
+        , init(_init)
+        , total(_init)
+        , ifirst(_ifirst)
+        , dfirst(_dfirst)
+        , n(std::distance(_ifirst, ilast))
+        , blockElems(chooseBlockElems(_ifirst, ilast))
+        , numBlocks(1 + (n - 1) / blockElems)
+    {}
+
+    inline void operator() (swarm::Timestamp) {
+        if (numBlocks == 1) {
+            scalar(0, n, Inclusive ? T(*ifirst) : init, Inclusive);
+            swarm::enqueueLambda(cb, cbts, EnqFlags::NOHINT, total);
+            free(this);
+            return;
+        }
+
+        swarm::deepen();
+
+        swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), swarm::max_children - 1>(
+                swarm::u64it(0ul), swarm::u64it(numBlocks),
+                [this] (swarm::Timestamp ts, uint64_t b) {
+            InputIt begin = this->ifirst + b * blockElems;
+            swarm::enqueue(Scanner::upsweep, ts,
+                    {swarm::Hint::cacheLine(&(*begin)), EnqFlags::MAYSPEC},
+                    this, b);
+        }, 0ul);
+
+        swarm::enqueue(Scanner::scanSums, 1, EnqFlags(NOHINT | CANTSPEC),
+                       this);
+    }
+
+
+    static void upsweep(swarm::Timestamp, Scanner* s, uint64_t b) {
+        InputIt begin = s->ifirst + b * s->blockElems;
+        InputIt end = s->ifirst + std::min((b + 1) * s->blockElems, s->n);
+        T sum = *begin;
+        s->blockSums[b] = std::accumulate(begin + 1, end, sum, s->o);
+    }
+
+
+    // Turn each block's sum into the exclusive prefix of the blocks before
+    // it, then spawn the downsweep
+    static void scanSums(swarm::Timestamp, Scanner* s) {
+        // For an inclusive scan there is no identity to seed block 0, so its
+        // slot is left alone and its downsweep seeds itself (see below)
+        T running = Inclusive ? static_cast<T>(s->blockSums[0]) : s->init;
+        for (uint64_t b = Inclusive ? 1 : 0; b < s->numBlocks; b++) {
+            T prev = s->blockSums[b];
+            s->blockSums[b] = running;
+            running = s->o(running, prev);
+        }
+        s->total = running;
+
+        swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), swarm::max_children - 1>(
+                swarm::u64it(0ul), swarm::u64it(s->numBlocks),
+                [s] (swarm::Timestamp ts, uint64_t b) {
+            auto* out = &(*(s->dfirst + b * s->blockElems));
+            swarm::enqueue(Scanner::downsweep, ts,
+                    {swarm::Hint::cacheLine(out), EnqFlags::MAYSPEC},
+                    s, b);
+        }, 2ul);
+
+        swarm::enqueue(Scanner::finish, 3, EnqFlags(NOHINT | CANTSPEC), s);
+    }
+
+
+    static void downsweep(swarm::Timestamp, Scanner* s, uint64_t b) {
+        uint64_t lo = b * s->blockElems;
+        uint64_t hi = std::min(lo + s->blockElems, s->n);
+        bool seedFirst = Inclusive && b == 0;
+        s->scalar(lo, hi, seedFirst ? T(*(s->ifirst)) : T(s->blockSums[b]),
+                  seedFirst);
+    }
+
+
+    // Serially scan [lo, hi) seeded with running; if consumedFirst, running
+    // already holds element lo and is emitted as its output
+    void scalar(uint64_t lo, uint64_t hi, T running, bool consumedFirst) {
+        InputIt it = ifirst + lo;
+        OutputIt out = dfirst + lo;
+        InputIt end = ifirst + hi;
+        if (consumedFirst) {
+            *out = running;
+            ++it; ++out;
+        }
+        for (; it != end; ++it, ++out) {
+            // Read before writing, so the scan may run in place
+            T v = *it;
+            if (Inclusive) {
+                running = o(running, v);
+                *out = running;
+            } else {
+                *out = running;
+                running = o(running, v);
+            }
+        }
+        if (numBlocks == 1) total = running;
+    }
+
+
+    static void finish(swarm::Timestamp, Scanner* s) {
+        // Enqueue up one timestamp interval, like Reducer::finish
+        swarm::enqueueLambda(s->cb, s->cbts,
+                EnqFlags(NOHINT | PARENTDOMAIN), s->total);
+        free(s);
+    }
+};
+
+
+template <bool Inclusive, class InputIt, class OutputIt, class T,
+          class BinaryOp, class CallBackLambda>
+static inline void __scan(InputIt first, InputIt last, OutputIt d_first,
+                          T init, BinaryOp o, Timestamp ts,
+                          CallBackLambda cb) {
+    assert(first != last);
+    using Scanner = swarm::_scan::Scanner<Inclusive, InputIt, OutputIt, T,
+                                          BinaryOp, CallBackLambda>;
+    uint64_t blockElems = Scanner::chooseBlockElems(first, last);
+    uint64_t numBlocks =
+            1 + (std::distance(first, last) - 1) / blockElems;
+    void* b = malloc(sizeof(Scanner) +
+                     numBlocks * sizeof(swarm::aligned<T>));
+    auto s = new(b) Scanner(ts, cb, o, init, first, last, d_first);
+    // FIXME(mcj) MAYSPEC isn't necessarily safe. The caller should be able to
+    // express it.
+    swarm::enqueueLambda(s, ts,
+            {swarm::Hint::cacheLine(&(*first)), EnqFlags::MAYSPEC});
+}
+
+} // end namespace _scan
+
+
+template <class InputIt, class OutputIt, class T, class BinaryOp,
+          class CallBackLambda>
+void exclusive_scan(InputIt first, InputIt last, OutputIt d_first, T init,
+                    BinaryOp o, Timestamp ts, CallBackLambda cb) {
+    swarm::_scan::__scan<false>(first, last, d_first, init, o, ts, cb);
+}
+
+
+template <class InputIt, class OutputIt, class BinaryOp, class CallBackLambda>
+void inclusive_scan(InputIt first, InputIt last, OutputIt d_first,
+                    BinaryOp o, Timestamp ts, CallBackLambda cb) {
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    // init is unused for inclusive scans; block 0 seeds itself
+    swarm::_scan::__scan<true>(first, last, d_first, T(*first), o, ts, cb);
+}
+
+} // end namespace swarm
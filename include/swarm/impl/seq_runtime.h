@@ -33,15 +33,22 @@ namespace swarm {
 static inline void run() {
     zsim_roi_begin();
     while (!pq.empty()) {
-#ifndef PLS_SINGLE_TASKFUNC
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
         TaskState* t = pq.dequeueTop();
+#ifdef PLS_TASK_STATS
+        __statsDequeue(t->stats, t->enqCycle);
+#endif
         t->call();
+        delete t;  // recycles through the TaskPool
 #else
         auto args = pq.dequeueTop();
-        callFuncTuple(PLS_SINGLE_TASKFUNC, args);
+        __callTaskArgs(args);
 #endif
     }
     zsim_roi_end();
+#ifdef PLS_TASK_STATS
+    __printTaskStats();
+#endif
 }
 
 static inline void info(const char* str) {
@@ -71,6 +78,7 @@ static inline void undeepen() {
 static inline void setGvt(Timestamp) {}
 static inline void clearReadSet() {}
 static inline void recordAsAborted() {}
+static inline void mallocPartition(void*, void*, uint64_t) {}
 static inline Timestamp timestamp() {
     return 0;  // FIXME(victory): implement this for seq runtime
 }
@@ -36,7 +36,7 @@ template <typename T> struct __SeqTasks {
 template <typename T> swarm::PriorityQueue __SeqTasks<T>::pq;
 static swarm::PriorityQueue& pq = __SeqTasks<int>::pq;
 
-#ifndef PLS_SINGLE_TASKFUNC
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
 
 template<typename F, F* f, typename... Args>
 #ifdef SWTASKS_USE_UID
@@ -50,13 +50,19 @@ void __enqueueSwTask(Timestamp ts, Hint, Args... args) {
         f(ts, args...);
     }
 #ifdef SWTASKS_USE_UID
-    pq.push(new Task<F, f, Args...>(uid, ts, args...));
+    auto* t = new Task<F, f, Args...>(uid, ts, args...);
 #else
-    pq.push(new Task<F, f, Args...>(ts, args...));
+    auto* t = new Task<F, f, Args...>(ts, args...);
 #endif
+#ifdef PLS_TASK_STATS
+    t->stats = &__taskStatsFor<F, f>();
+    t->enqCycle = __rdtsc();
+    __statsEnqueue(t->stats);
+#endif
+    pq.push(t);
 }
 
-#else
+#elif defined(PLS_SINGLE_TASKFUNC)
 
 #ifndef SWTASKS_USE_UID
 template<typename F, F* f, typename... Args>
@@ -74,6 +80,30 @@ void __enqueueSwTask(uint64_t uid, Timestamp ts, Hint, Args... args) {
 }
 #endif
 
+#else  // PLS_TASKFUNC_REGISTRY
+
+#ifndef SWTASKS_USE_UID
+template<typename F, F* f, typename... Args>
+void __enqueueSwTask(Timestamp ts, Hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    pq.push(TaskArgs(__RegistryIndexOf<F, f>::value, ts, args...));
+}
+#else
+template<typename F, F* f, typename... Args>
+void __enqueueSwTask(uint64_t uid, Timestamp ts, Hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    pq.push(TaskArgs(uid, __RegistryIndexOf<F, f>::value, ts, args...));
+}
+#endif
+
 #endif
 
 }
@@ -0,0 +1,239 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include "../api.h"
+#include "../algorithm.h"
+#include "block.h"
+
+namespace swarm {
+namespace _sort {
+
+// A bottom-up parallel merge sort, structured like _reduce::Reducer: the
+// caller's enqueue makes the whole sort appear atomic at one timestamp, and
+// internally the Sorter deepens into a subdomain whose timestamps separate
+// the phases. Timestamp 0 sorts each block; timestamp r (1 <= r <= rounds)
+// runs merge round r, doubling the sorted run length; the last timestamp
+// frees the scratch buffer and enqueues the callback in the parent domain.
+//
+// Rounds ping-pong between the input array and a scratch buffer. The parity
+// is anchored so the final round writes the input array: when the number of
+// rounds is odd, the block sorts at timestamp 0 write their output to the
+// scratch buffer instead of sorting in place.
+//
+// Large merges split along the merge path: segment the larger input evenly,
+// binary-search the other input for the matching boundaries, and enqueue one
+// child merge per segment at the same timestamp. This keeps the last rounds
+// -- a single pair merging the whole array -- as parallel as the first.
+template <class Iterator, class Compare, class CallBackLambda>
+struct Sorter {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    // The scratch buffer holds raw copies of elements
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "swarm::sort requires trivially copyable elements");
+
+    swarm::Timestamp cbts;
+    CallBackLambda cb;
+    Compare cmp;
+    T* data;
+    uint64_t n;
+    T* scratch;
+    uint64_t blockElems;
+    uint64_t numBlocks;
+    uint32_t rounds;
+
+    Sorter(swarm::Timestamp ts, CallBackLambda _cb, Compare _cmp,
+           Iterator first, Iterator last)
+        : cbts(ts)
+        , cb(_cb)
+        , cmp(_cmp)
+        , data(&(*first))
+        , n(std::distance(first, last))
+        , scratch(nullptr)
+        // grainSize already targets ~4 tasks per thread, so the merge tree
+        // is only log2(4 * num_threads()) rounds deep
+        , blockElems(std::max(
+                swarm::block::elementsPerLine<Iterator>(),
+                static_cast<uint64_t>(swarm::block::grainSize(first, last)) *
+                        SWARM_CACHE_LINE / sizeof(T)))
+        , numBlocks(1 + (n - 1) / blockElems)
+        , rounds(numBlocks <= 1 ? 0 : 64 - __builtin_clzl(numBlocks - 1))
+    {}
+
+    // The buffer merge round r writes (round 0 is the block sorts)
+    inline T* dstBuf(uint32_t r) const {
+        return ((rounds - r) % 2) ? scratch : data;
+    }
+    inline T* srcBuf(uint32_t r) const {
+        return ((rounds - r) % 2) ? data : scratch;
+    }
+
+    inline void operator() (swarm::Timestamp) {
+        if (rounds == 0) {
+            std::sort(data, data + n, cmp);
+            swarm::enqueueLambda(cb, cbts,
+                    {swarm::Hint::cacheLine(data), EnqFlags::MAYSPEC});
+            delete this;
+            return;
+        }
+
+        scratch = static_cast<T*>(malloc(n * sizeof(T)));
+        swarm::deepen();
+
+        swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), swarm::max_children - 1>(
+                swarm::u64it(0ul), swarm::u64it(numBlocks),
+                [this] (swarm::Timestamp ts, uint64_t b) {
+            swarm::enqueue(Sorter::sortBlock, ts,
+                    {swarm::Hint::cacheLine(dstBuf(0) + b * blockElems),
+                     EnqFlags::MAYSPEC},
+                    this, b);
+        }, 0ul);
+
+        swarm::enqueue(Sorter::driveRound, 1,
+                     EnqFlags(NOHINT | MAYSPEC), this, 1u);
+    }
+
+
+    static void sortBlock(swarm::Timestamp, Sorter* s, uint64_t b) {
+        T* out = s->dstBuf(0);
+        uint64_t lo = b * s->blockElems;
+        uint64_t hi = std::min(lo + s->blockElems, s->n);
+        if (out != s->data) std::copy(s->data + lo, s->data + hi, out + lo);
+        std::sort(out + lo, out + hi, s->cmp);
+    }
+
+
+    // Enqueue merge round r's pair merges at timestamp r (== ts), then chain
+    // to the next round. Runs of width elements are merged pairwise; a
+    // trailing lone run is still merged (with an empty partner) so it moves
+    // to the round's output buffer.
+    static void driveRound(swarm::Timestamp ts, Sorter* s, uint32_t r) {
+        const uint64_t width = s->blockElems << (r - 1);
+        const uint64_t pairs = 1 + (s->n - 1) / (2 * width);
+        swarm::enqueue_all<EnqFlags(NOHINT | MAYSPEC), swarm::max_children - 1>(
+                swarm::u64it(0ul), swarm::u64it(pairs),
+                [s, r, width] (swarm::Timestamp ts, uint64_t p) {
+            uint64_t a0 = 2 * p * width;
+            uint64_t a1 = std::min(a0 + width, s->n);
+            uint64_t b1 = std::min(a0 + 2 * width, s->n);
+            swarm::enqueue(Sorter::merge, ts,
+                    {swarm::Hint::cacheLine(s->dstBuf(r) + a0),
+                     EnqFlags::MAYSPEC},
+                    s, s->srcBuf(r), a0, a1, a1, b1, a0);
+        }, ts);
+
+        if (r < s->rounds)
+            swarm::enqueue(Sorter::driveRound, ts + 1,
+                         EnqFlags(SAMEHINT | MAYSPEC), s, r + 1);
+        else
+            swarm::enqueue(Sorter::finish, ts + 1,
+                         EnqFlags(NOHINT | CANTSPEC), s);
+    }
+
+
+    // Merge src[a0,a1) and src[b0,b1) into the other buffer at offset d0.
+    // The two input runs are adjacent in src, but a recursive split gets
+    // non-adjacent pieces of them, so all four bounds are explicit.
+    static void merge(swarm::Timestamp ts, Sorter* s, T* src,
+                      uint64_t a0, uint64_t a1,
+                      uint64_t b0, uint64_t b1, uint64_t d0) {
+        T* dst = (src == s->data) ? s->scratch : s->data;
+        const uint64_t total = (a1 - a0) + (b1 - b0);
+        const uint64_t segs = std::min<uint64_t>(
+                swarm::max_children, total / (2 * s->blockElems));
+        if (segs < 2) {
+            std::merge(src + a0, src + a1, src + b0, src + b1,
+                       dst + d0, s->cmp);
+            return;
+        }
+
+        // Split the larger input into segs equal pieces and binary-search
+        // the smaller for the matching cut. lower_bound on one side and
+        // upper_bound on the other sends ties from the first run left of
+        // ties from the second, so the merge stays stable.
+        uint64_t pa = a0, pb = b0;
+        for (uint64_t i = 1; i <= segs; i++) {
+            uint64_t ai, bi;
+            if (i == segs) {
+                ai = a1; bi = b1;
+            } else if (a1 - a0 >= b1 - b0) {
+                ai = a0 + (a1 - a0) * i / segs;
+                bi = std::lower_bound(src + pb, src + b1, src[ai], s->cmp)
+                        - src;
+            } else {
+                bi = b0 + (b1 - b0) * i / segs;
+                ai = std::upper_bound(src + pa, src + a1, src[bi], s->cmp)
+                        - src;
+            }
+            uint64_t d = d0 + (pa - a0) + (pb - b0);
+            swarm::enqueue(Sorter::merge, ts,
+                    {swarm::Hint::cacheLine(dst + d), EnqFlags::MAYSPEC},
+                    s, src, pa, ai, pb, bi, d);
+            pa = ai; pb = bi;
+        }
+    }
+
+
+    static void finish(swarm::Timestamp, Sorter* s) {
+        free(s->scratch);
+        // Enqueue up one timestamp interval, like Reducer::finish
+        swarm::enqueueLambda(s->cb, s->cbts,
+                {swarm::Hint::cacheLine(s->data),
+                 EnqFlags(MAYSPEC | PARENTDOMAIN)});
+        delete s;
+    }
+};
+
+} // end namespace _sort
+
+
+template <class Iterator, class Compare, class CallBackLambda>
+static inline void sort(Iterator first, Iterator last, Compare cmp,
+                        Timestamp ts, CallBackLambda cb) {
+    if (std::distance(first, last) < 2) {
+        swarm::enqueueLambda(cb, ts, EnqFlags::NOHINT);
+        return;
+    }
+    using Sorter = swarm::_sort::Sorter<Iterator, Compare, CallBackLambda>;
+    auto* s = new Sorter(ts, cb, cmp, first, last);
+    // FIXME(mcj) MAYSPEC isn't necessarily safe. The caller should be able to
+    // express it.
+    swarm::enqueueLambda(s, ts,
+            {swarm::Hint::cacheLine(&(*first)), EnqFlags::MAYSPEC});
+}
+
+
+template <class Iterator, class Compare>
+static inline void sort(Iterator first, Iterator last, Compare cmp,
+                        Timestamp ts) {
+    swarm::sort(first, last, cmp, ts, [] (swarm::Timestamp) {});
+}
+
+
+template <class Iterator>
+static inline void sort(Iterator first, Iterator last, Timestamp ts) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    swarm::sort(first, last, std::less<T>(), ts);
+}
+
+}
@@ -33,9 +33,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <cstdlib>
 #include <algorithm>
 #include <array>
+#include <new>
+#include <utility>
 // No application should ever #include spillers.h directly.
 #include "../aligned.h"
 #include "../hooks.h"
@@ -59,9 +63,77 @@ struct TaskDescriptor {
 
 struct TaskDescriptors {
     uint64_t size;
+    uint64_t capacity;  // in descriptors; the freelist only recycles
+                        // fixed-capacity buffers (see below)
     TaskDescriptor tds[0];  // that's OK, we'll dynamically size it
 };
 
+// Fixed capacity of recyclable spill buffers, in descriptors. Also the
+// ceiling for the adaptive spill chunk.
+constexpr uint32_t __spillBufferCapacity = 128;
+
+/* Per-tile spill state: a few cached spill buffers that spillers and
+ * requeuers recycle (avoiding zero-cycle alloc/free churn and cold buffers in
+ * the spill path), plus counters that drive adaptive spill chunk sizing.
+ * Spillers and requeuers run non-speculatively, so unlike the rest of the
+ * runtime this state needs real synchronization: buffers move through slots
+ * with atomic exchanges (a linked freelist would need ABA protection).
+ */
+struct alignas(SWARM_CACHE_LINE) SpillTileState {
+    static constexpr uint32_t kSlots = 4;
+    std::atomic<TaskDescriptors*> slots[kSlots] = {};
+    // Approximate bookkeeping: plain loads/stores; lost updates under
+    // concurrent spillers only perturb the heuristic
+    uint32_t chunk = 0;     // adapted spill count; 0 until the first spill
+    uint64_t spilled = 0;   // tasks moved into spill buffers
+    uint64_t refilled = 0;  // tasks replayed by requeuers
+};
+
+// See __HWMiscState (hwmisc.h) for why this isn't a plain inline variable
+template <typename T> struct __SpillFreelistState {
+    static SpillTileState* tiles;
+};
+template <typename T> SpillTileState* __SpillFreelistState<T>::tiles = nullptr;
+static SpillTileState*& __spillTiles = __SpillFreelistState<int>::tiles;
+
+// Called once before launching threads (see setup_task_handlers)
+static inline void __setup_spill_freelists() {
+    uint32_t ntiles = numTiles();
+    void* mem;
+    if (posix_memalign(&mem, SWARM_CACHE_LINE,
+                       ntiles * sizeof(SpillTileState)))
+        std::abort();
+    auto* tiles = static_cast<SpillTileState*>(mem);
+    for (uint32_t t = 0; t < ntiles; t++) new (&tiles[t]) SpillTileState();
+    __spillTiles = tiles;
+}
+
+static inline SpillTileState* __spillTileState() {
+    return __spillTiles ? &__spillTiles[tileId()] : nullptr;
+}
+
+static inline TaskDescriptors* __acquireSpillBuffer(SpillTileState* st) {
+    for (auto& slot : st->slots) {
+        TaskDescriptors* buf = slot.exchange(nullptr,
+                                             std::memory_order_acquire);
+        if (buf) return buf;
+    }
+    return nullptr;
+}
+
+static inline void __releaseSpillBuffer(SpillTileState* st,
+                                        TaskDescriptors* descs) {
+    if (st && descs->capacity == __spillBufferCapacity) {
+        for (auto& slot : st->slots) {
+            TaskDescriptors* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, descs,
+                                             std::memory_order_release))
+                return;
+        }
+    }
+    sim_zero_cycle_free(descs);
+}
+
 template<bool isFrame>
 static inline void __enqueueOrYield(const TaskDescriptor& task) {
     // N.B. any task originally enqueued with NOHINT was assigned a hint
@@ -104,6 +176,9 @@ static inline void __enqueueOrYield(const TaskDescriptor& task) {
 // Requeuers were called "splitters" in the early Swarm papers
 template <bool isFrame>
 static inline void requeuer_impl(swarm::Timestamp, TaskDescriptors* descs) {
+    // Requeuers run on the same tile as their spiller, so this recycles the
+    // buffer into the tile that will spill next
+    SpillTileState* st = __spillTileState();
     // This requeuer can yield before an enqueue, so we always update the size
     // field directly
     __builtin_prefetch(&descs->tds[descs->size - 1].ts);
@@ -113,8 +188,11 @@ static inline void requeuer_impl(swarm::Timestamp, TaskDescriptors* descs) {
         }
         __enqueueOrYield<isFrame>(descs->tds[descs->size - 1]);
         descs->size--;
+        // Count per enqueue, not per buffer: a yield re-runs this function,
+        // which would double-count the remainder
+        if (st) st->refilled++;
     }
-    sim_zero_cycle_free(descs);
+    __releaseSpillBuffer(st, descs);
 }
 
 static inline void requeuer(swarm::Timestamp ts, TaskDescriptors* descs) {
@@ -193,9 +271,34 @@ static inline uint64_t __removeOne(TaskDescriptor* task, TaskDescriptor* end,
 
 template<bool isFrame>
 static inline void spiller_impl(swarm::Timestamp, const uint32_t n) {
-    // Remove n oldest untied tasks from the tile and dump them into memory
-    TaskDescriptors* tdstruct = (TaskDescriptors*) sim_zero_cycle_untracked_malloc(
-                        sizeof(TaskDescriptors) + n*sizeof(TaskDescriptor));
+    SpillTileState* st = __spillTileState();
+    uint32_t chunk = n;
+    TaskDescriptors* tdstruct = nullptr;
+    if (st) {
+        // Adapt the spill count to the recent net overflow, rather than
+        // always using the registration-time constant n: while spills far
+        // outpace refills the queue is persistently overflowing, and larger
+        // chunks amortize the per-spill overheads; once refills catch up,
+        // shrink back toward n so tasks don't linger in memory.
+        chunk = st->chunk ? st->chunk : n;
+        uint64_t pending = st->spilled - st->refilled;
+        if (pending > 4ul * chunk) {
+            chunk = std::min(2u * chunk, __spillBufferCapacity);
+        } else if (pending < chunk / 2) {
+            chunk = std::max(chunk / 2u, n);
+        }
+        st->chunk = chunk;
+        tdstruct = __acquireSpillBuffer(st);
+    }
+    if (!tdstruct) {
+        // Recyclable buffers have fixed capacity so any spiller on this tile
+        // can reuse them regardless of its chunk
+        uint32_t cap = st ? std::max(__spillBufferCapacity, chunk) : chunk;
+        tdstruct = (TaskDescriptors*) sim_zero_cycle_untracked_malloc(
+                            sizeof(TaskDescriptors) + cap*sizeof(TaskDescriptor));
+        tdstruct->capacity = cap;
+    }
+    assert(chunk <= tdstruct->capacity);
     TaskDescriptor* tasks = tdstruct->tds;
 
     // Prefetch for a later write (1)
@@ -205,7 +308,7 @@ static inline void spiller_impl(swarm::Timestamp, const uint32_t n) {
                                          : MAGIC_OP_TASK_REMOVE_UNTIED;
     uint64_t minTs = UINT64_MAX;
     TaskDescriptor* const begin = tasks;
-    TaskDescriptor* const end = tasks + n;
+    TaskDescriptor* const end = tasks + chunk;
     TaskDescriptor* task;
     // For ordinary (non-frame) spilling, tag the requeuer as
     // * NOTIMESTAMP iff all spilled tasks are NOTIMESTAMP
@@ -239,6 +342,7 @@ static inline void spiller_impl(swarm::Timestamp, const uint32_t n) {
     }
 
     tdstruct->size = std::distance(begin, task);
+    if (st) st->spilled += tdstruct->size;
 
     if (tdstruct->size > 0) {
         if (!isFrame) {
@@ -261,7 +365,7 @@ static inline void spiller_impl(swarm::Timestamp, const uint32_t n) {
         // Frankly, if spillers are frequently removing single tasks, then
         // there is a more important problem to solve in terms of when a
         // spiller is launched.
-        sim_zero_cycle_free(tdstruct);
+        __releaseSpillBuffer(st, tdstruct);
     }
 }
 
@@ -276,4 +380,167 @@ inline void frame_spiller(swarm::Timestamp ts, const uint32_t n) {
 }
 
 
+#ifdef PLS_SINGLE_TASKFUNC
+#ifndef PLS_SINGLE_TASKFUNC_ARGS
+#error "Must define PLS_SINGLE_TASKFUNC_ARGS with PLS_SINGLE_TASKFUNC"
+#endif
+
+/* Compact spill path for single-taskfn apps. Nearly all spilled tasks run
+ * PLS_SINGLE_TASKFUNC, so the full TaskDescriptor wastes a word on the
+ * constant task pointer and (PLS_APP_MAX_ARGS - nargs) unused arg slots per
+ * descriptor. Registering the function with the simulator
+ * (MAGIC_OP_REGISTER_SPILLER in setup_task_handlers) makes this spiller
+ * remove only that function's tasks (MAGIC_OP_REMOVE_UNTIED_TASKFN), so
+ * descriptors can drop the task pointer and carry exactly the function's
+ * argument count; the generic spiller above still handles everything else
+ * (requeuers, runners, etc.).
+ */
+
+constexpr uint32_t __compactArgs =
+        std::tuple_size<std::tuple<PLS_SINGLE_TASKFUNC_ARGS>>::value;
+static_assert(__compactArgs <= PLS_APP_MAX_ARGS,
+              "The single taskfn's argument list exceeds PLS_APP_MAX_ARGS");
+
+struct CompactTaskDescriptor {
+    uint64_t ts;
+    uint64_t flags;  // low 16 bits of taskPtrAndFlags; the ptr is implicit
+    uint64_t hint;
+    uint64_t args[__compactArgs];
+};
+
+struct CompactTaskDescriptors {
+    uint64_t size;
+    CompactTaskDescriptor tds[0];
+};
+
+static inline uint64_t __compactTaskPtr() {
+    // Must match the runner the enqueue path (hwtasks.h) uses for the
+    // single taskfn, which is what the hardware queues store
+    return reinterpret_cast<uint64_t>(
+            bareRunner<decltype(PLS_SINGLE_TASKFUNC), PLS_SINGLE_TASKFUNC,
+                       PLS_SINGLE_TASKFUNC_ARGS>);
+}
+
+template <size_t... I>
+static inline void __enqueueCompactOrYield(const CompactTaskDescriptor& task,
+                                           std::index_sequence<I...>) {
+    // See __enqueueOrYield above on reusing the (possibly assigned) hint
+    EnqFlags ef = EnqFlags(YIELDIFFULL | (task.flags & 0x0fffful));
+    uint64_t magicOp = enqueueMagicOp(__compactArgs, ef);
+    swarm::__enqueue_task_skipargs(magicOp, __compactTaskPtr(), task.ts,
+                                   task.hint, task.args[I]...);
+}
+
+static inline void compact_requeuer(swarm::Timestamp,
+                                    CompactTaskDescriptors* descs) {
+    SpillTileState* st = __spillTileState();
+    __builtin_prefetch(&descs->tds[descs->size - 1].ts);
+    while (descs->size) {
+        __enqueueCompactOrYield(descs->tds[descs->size - 1],
+                                std::make_index_sequence<__compactArgs>());
+        descs->size--;
+        if (st) st->refilled++;
+    }
+    // Compact buffers skip the tile's recycling slots, whose buffers are
+    // sized in full TaskDescriptors
+    sim_zero_cycle_free(descs);
+}
+
+static inline uint64_t __removeOneCompact(CompactTaskDescriptor* task,
+                                          CompactTaskDescriptor* end,
+                                          uint64_t minTs,
+                                          uint64_t* requeuerFlags,
+                                          bool* nonTimestamped) {
+    // Compact descriptors pack ~2x more tasks per line, so one line ahead
+    // covers the same lookahead as the generic spiller's two
+    constexpr uint64_t mask = ~(SWARM_CACHE_LINE - 1ul);
+    void* prefetch = (void*)(mask &
+            (reinterpret_cast<uintptr_t>(&task->ts) + SWARM_CACHE_LINE));
+    if (pls_likely(prefetch < end)) __builtin_prefetch(prefetch, 1);
+
+    uint64_t ts;
+    uint64_t taskPtrAndFlags;
+    uint64_t hint;
+
+    uint64_t a0;
+    register uint64_t a1      asm("r8");
+    register uint64_t a2      asm("r9");
+    register uint64_t a3      asm("r10");
+    register uint64_t a4      asm("r11");
+
+    COMPILER_BARRIER();
+    // See __removeOne for why the MAGIC_OP moves through rcx separately
+    asm volatile("mov %0, %%rcx;"
+        :
+        : "g" ((uint64_t)MAGIC_OP_REMOVE_UNTIED_TASKFN)
+        :);
+    asm volatile("xchg %%rcx, %%rcx;"
+        : "=D"(ts), "=S"(taskPtrAndFlags), "=d"(hint),
+          "=c"(a0), "=r"(a1), "=r"(a2), "=r"(a3), "=r"(a4)
+        : "D"(minTs), "S"(__compactTaskPtr())
+        :);
+    COMPILER_BARRIER();
+
+    if (pls_unlikely(taskPtrAndFlags == 0ul)) return UINT64_MAX;
+    *requeuerFlags &= taskPtrAndFlags;
+    *nonTimestamped = taskPtrAndFlags & EnqFlags::NOTIMESTAMP;
+
+    task->ts = ts;
+    task->flags = taskPtrAndFlags & 0x0fffful;
+    task->hint = hint;
+    const uint64_t regs[] = {a0, a1, a2, a3, a4};
+    for (uint32_t i = 0; i < __compactArgs; i++) task->args[i] = regs[i];
+    return ts;
+}
+
+__attribute__((noinline))
+inline void compact_spiller(swarm::Timestamp, const uint32_t n) {
+    SpillTileState* st = __spillTileState();
+    // Compact buffers are already ~half the bytes per spilled task, so skip
+    // the adaptive chunk sizing and recycling slots and just take a
+    // right-sized buffer every time
+    auto* descs = static_cast<CompactTaskDescriptors*>(
+            sim_zero_cycle_untracked_malloc(
+                sizeof(CompactTaskDescriptors) +
+                n * sizeof(CompactTaskDescriptor)));
+    CompactTaskDescriptor* const begin = descs->tds;
+    CompactTaskDescriptor* const end = begin + n;
+    __builtin_prefetch(&begin->ts, 1);
+
+    // Same structure as spiller_impl<false>: track the min removed timestamp
+    // and the AND of the removed tasks' flags, and bound maxTS to 0 once a
+    // non-timestamped task is found
+    uint64_t minTs = UINT64_MAX;
+    uint64_t requeuerFlags = EnqFlags(NOTIMESTAMP | CANTSPEC);
+    bool nonTimestamped = false;
+    CompactTaskDescriptor* task;
+    for (task = begin; task < end; task++) {
+        uint64_t newMin = __removeOneCompact(task, end, minTs,
+                                             &requeuerFlags, &nonTimestamped);
+        if (nonTimestamped || newMin == UINT64_MAX) break;
+        minTs = newMin;
+    }
+    if (nonTimestamped) {
+        for (task = task + 1; task < end; task++) {
+            uint64_t newMin = __removeOneCompact(task, end, 0,
+                    &requeuerFlags, &nonTimestamped);
+            if (newMin == UINT64_MAX) break;
+            if (!nonTimestamped) minTs = 0ul;
+        }
+    }
+
+    descs->size = std::distance(begin, task);
+    if (st) st->spilled += descs->size;
+
+    if (descs->size > 0) {
+        EnqFlags ef = SAMEHINT | NONSERIALHINT | NOHASH |
+                      PRODUCER | REQUEUER | (EnqFlags)requeuerFlags;
+        swarm::enqueue(swarm::compact_requeuer, minTs, ef, descs);
+    } else {
+        sim_zero_cycle_free(descs);
+    }
+}
+
+#endif  // PLS_SINGLE_TASKFUNC
+
 } // end namespace swarm
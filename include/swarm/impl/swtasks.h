@@ -28,10 +28,13 @@
 #include <tuple>
 #include <assert.h>
 
+#include <algorithm>
 #include <queue>
+#include <vector>
 #include <ext/pb_ds/priority_queue.hpp>
 
 #include "callfunc.h"
+#include "taskstats.h"
 #include "types.h"
 
 namespace swarm {
@@ -50,11 +53,168 @@ class dtpq : public PQ {
         }
 };
 
-#ifndef PLS_SINGLE_TASKFUNC
+// A calendar-queue alternative to the comparison-based heaps above, selected
+// by defining PLS_BUCKET_QUEUE (like PLS_SINGLE_TASKFUNC, a build-time
+// choice). Heaps pay O(log n) pointer-chasing per operation, which dominates
+// seq/tls runs that carry tens of millions of pending tasks. Here a push
+// appends to the open-hashed bucket of its timestamp (contiguous storage, no
+// rebalancing), and dequeues drain one timestamp's entries at a time, so both
+// are amortized O(1) when pending timestamps are dense. A sparse stretch --
+// a whole pass over the calendar without finding work -- falls back to a
+// full scan that jumps directly to the minimum pending timestamp.
+template <typename T, uint64_t (*TsOf)(const T&)>
+class BucketQueue {
+    static constexpr uint64_t kBuckets = 1024;  // must be a power of 2
+
+    std::vector<T> buckets[kBuckets];
+    std::vector<T> drain;  // entries with ts == day, served back to front
+    uint64_t day;          // timestamp currently being drained
+    uint64_t lowWater;     // lower bound on the smallest ts in buckets
+    uint64_t n;
+
+    // Move day-d entries from d's bucket into the drain, keeping the rest
+    // (future "years" that hash to the same bucket) in place.
+    bool collect(uint64_t d) {
+        auto& b = buckets[d % kBuckets];
+        size_t keep = 0;
+        for (size_t i = 0; i < b.size(); i++) {
+            if (TsOf(b[i]) == d) drain.push_back(b[i]);
+            else b[keep++] = b[i];
+        }
+        b.resize(keep);
+        return !drain.empty();
+    }
+
+    void advance() {
+        assert(n);
+        // Start below day if anything was pushed into the past; re-collect
+        // day itself, since a task pushed at the timestamp being drained
+        // lands in its bucket.
+        uint64_t start = std::min(day, lowWater);
+        for (uint64_t d = start; d < start + kBuckets; d++) {
+            if (collect(d)) {
+                day = d;
+                lowWater = d;
+                return;
+            }
+        }
+        // Sparse region: jump straight to the minimum pending timestamp.
+        uint64_t m = UINT64_MAX;
+        for (const auto& b : buckets)
+            for (const T& e : b) m = std::min(m, TsOf(e));
+        assert(m != UINT64_MAX);
+        bool found = collect(m);
+        assert(found); (void)found;
+        day = m;
+        lowWater = m;
+    }
+
+  public:
+    BucketQueue() : day(0), lowWater(0), n(0) {}
+
+    inline bool empty() const { return n == 0; }
+
+    inline void push(T e) {
+        uint64_t ts = TsOf(e);
+        n++;
+        if (ts == day && !drain.empty()) {
+            drain.push_back(e);
+        } else {
+            buckets[ts % kBuckets].push_back(e);
+            lowWater = std::min(lowWater, ts);
+        }
+    }
+
+    inline T dequeueTop() {
+        if (drain.empty()) advance();
+        T e = drain.back();
+        drain.pop_back();
+        n--;
+        return e;
+    }
+
+    inline uint64_t minTs() {
+        if (drain.empty()) advance();
+        return day;
+    }
+};
+
+#if defined(PLS_SINGLE_TASKFUNC) && defined(PLS_TASKFUNC_REGISTRY)
+#error "PLS_SINGLE_TASKFUNC and PLS_TASKFUNC_REGISTRY are mutually exclusive"
+#endif
+
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
+
+// Size-class slab pool for Task objects. Software-queued runtimes allocate
+// one Task per enqueue and (now) free it right after the call, so at hundreds
+// of millions of tasks per run the general-purpose heap dominates the
+// enqueue/dequeue profile. Instead, carve slabs per size class and recycle
+// freed Tasks through freelists, so the steady state never touches malloc.
+// Slabs are never returned; peak task count bounds the footprint.
+// As with the queues themselves, concurrent freelist accesses in the TLS
+// runtime are resolved by the simulator's speculation, so there are no locks.
+class TaskPool {
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxSize = 256;
+    static constexpr size_t kClasses = kMaxSize / kGranularity;
+    static constexpr size_t kObjsPerSlab = 64;
+
+    // Freed objects are linked through their first word.
+    void* freeLists[kClasses];
+
+    static inline size_t classOf(size_t bytes) {
+        return (bytes - 1) / kGranularity;
+    }
+
+    void refill(size_t c) {
+        size_t objBytes = (c + 1) * kGranularity;
+        char* slab = static_cast<char*>(::operator new(objBytes * kObjsPerSlab));
+        for (size_t i = 0; i < kObjsPerSlab; i++) {
+            void* obj = slab + i * objBytes;
+            *static_cast<void**>(obj) = freeLists[c];
+            freeLists[c] = obj;
+        }
+    }
+
+  public:
+    TaskPool() : freeLists() {}
+
+    inline void* alloc(size_t bytes) {
+        if (pls_unlikely(bytes > kMaxSize)) return ::operator new(bytes);
+        size_t c = classOf(bytes);
+        if (pls_unlikely(!freeLists[c])) refill(c);
+        void* p = freeLists[c];
+        freeLists[c] = *static_cast<void**>(p);
+        return p;
+    }
+
+    inline void free(void* p, size_t bytes) {
+        if (pls_unlikely(bytes > kMaxSize)) {
+            ::operator delete(p);
+            return;
+        }
+        size_t c = classOf(bytes);
+        *static_cast<void**>(p) = freeLists[c];
+        freeLists[c] = p;
+    }
+};
+
+// [victory] C++17 would allow defining an inline variable in this header file.
+// But since we want to support older versions of GCC, lets use the
+// static-member-of-class-template trick.  See: https://wg21.link/n4424
+template <typename T> struct __TaskPoolState {
+  static TaskPool pool;
+};
+template <typename T> TaskPool __TaskPoolState<T>::pool;
+static TaskPool& taskPool = __TaskPoolState<int>::pool;
 
 struct TaskState {
 #ifdef SWTASKS_USE_UID
     const uint64_t uid;
+#endif
+#ifdef PLS_TASK_STATS
+    TaskFnStats* stats;  // set by the enqueue path (see taskstats.h)
+    uint64_t enqCycle;
 #endif
     const Timestamp ts;
 #ifdef SWTASKS_USE_UID
@@ -64,6 +224,20 @@ struct TaskState {
 #endif
     virtual ~TaskState() = default;
     virtual void call() = 0;
+
+    // Route all Task allocations through the pool. The virtual destructor
+    // makes the sized delete below see the most-derived Task's size, so
+    // objects return to the size class they came from.
+    static void* operator new(size_t bytes) { return taskPool.alloc(bytes); }
+    static void operator delete(void* p, size_t bytes) {
+        taskPool.free(p, bytes);
+    }
+
+    // The class-scope operator new above hides the global placement form;
+    // redeclare it so the oracle runtime can place Tasks into its arena
+    // (see oracle_arena.h).
+    static void* operator new(size_t, void* p) { return p; }
+    static void operator delete(void*, void*) {}
 };
 
 template <typename F, F* f, typename... Args>
@@ -101,13 +275,19 @@ inline uint64_t GetTimestamp(TaskState* const& a) {
     return a->ts;
 }
 
+#ifdef PLS_BUCKET_QUEUE
+using PriorityQueue = BucketQueue<TaskState*, GetTimestamp>;
+#else
 using PriorityQueue = dtpq<TaskState*, std::priority_queue<TaskState*, std::vector<TaskState*>, CompareTasks>, GetTimestamp>;
 // dsm: PBDS is slower than the native priority_queue here...
 // pairing heap performs better than thin and binary heaps; binomial and rc_binomial do not compile
 //using PriorityQueue = __gnu_pbds::priority_queue<TaskState*, CompareTasks, __gnu_pbds::pairing_heap_tag>;
+#endif
 
 #else
 
+#ifdef PLS_SINGLE_TASKFUNC
+
 #ifndef PLS_SINGLE_TASKFUNC_ARGS
 #error "Must define PLS_SINGLE_TASKFUNC_ARGS with PLS_SINGLE_TASKFUNC"
 #endif
@@ -121,6 +301,62 @@ typedef std::tuple<Timestamp, PLS_SINGLE_TASKFUNC_ARGS> TaskArgs;
 typedef std::tuple<uint64_t, Timestamp, PLS_SINGLE_TASKFUNC_ARGS> TaskArgs;
 #endif
 
+#else  // PLS_TASKFUNC_REGISTRY
+
+#ifndef PLS_TASKFUNC_REGISTRY_ARGS
+#error "Must define PLS_TASKFUNC_REGISTRY_ARGS with PLS_TASKFUNC_REGISTRY"
+#endif
+
+// Extends the PLS_SINGLE_TASKFUNC representation to apps with a handful of
+// task functions: PLS_TASKFUNC_REGISTRY lists them (all sharing the signature
+// given by PLS_TASKFUNC_REGISTRY_ARGS), each task carries the function's
+// index in the list, and the runloops dispatch through a constexpr table.
+// The representation stays a POD tuple in the pairing heap: no virtual
+// TaskState and no per-task heap allocation.
+typedef void __RegistryFn(Timestamp, PLS_TASKFUNC_REGISTRY_ARGS);
+
+template <__RegistryFn*... Fns>
+struct __TaskFnList {
+    static constexpr uint64_t size = sizeof...(Fns);
+    static constexpr __RegistryFn* table[sizeof...(Fns)] = {Fns...};
+};
+template <__RegistryFn*... Fns>
+constexpr __RegistryFn* __TaskFnList<Fns...>::table[sizeof...(Fns)];
+
+using __TaskRegistry = __TaskFnList<PLS_TASKFUNC_REGISTRY>;
+
+// The index of F in the registry list. An "incomplete type" error here
+// means the enqueued function is not listed in PLS_TASKFUNC_REGISTRY.
+template <__RegistryFn* F, __RegistryFn* Head, __RegistryFn*... Tail>
+struct __TaskFnIndex {
+    static constexpr uint64_t value = 1ul + __TaskFnIndex<F, Tail...>::value;
+};
+template <__RegistryFn* F, __RegistryFn*... Tail>
+struct __TaskFnIndex<F, F, Tail...> {
+    static constexpr uint64_t value = 0ul;
+};
+
+// An "incomplete type" error here means the enqueued function does not
+// have the void(Timestamp, PLS_TASKFUNC_REGISTRY_ARGS) signature.
+template <typename F, F* f> struct __RegistryIndexOf;
+template <__RegistryFn* f> struct __RegistryIndexOf<__RegistryFn, f> {
+    static constexpr uint64_t value =
+            __TaskFnIndex<f, PLS_TASKFUNC_REGISTRY>::value;
+};
+
+#ifndef SWTASKS_USE_UID
+#define TASKARGS_FN_POS 0
+#define TASKARGS_TS_POS 1
+typedef std::tuple<uint64_t, Timestamp, PLS_TASKFUNC_REGISTRY_ARGS> TaskArgs;
+#else
+#define TASKARGS_FN_POS 1
+#define TASKARGS_TS_POS 2
+typedef std::tuple<uint64_t, uint64_t, Timestamp, PLS_TASKFUNC_REGISTRY_ARGS>
+        TaskArgs;
+#endif
+
+#endif  // PLS_TASKFUNC_REGISTRY
+
 struct CompareTasks {
     bool operator()(const TaskArgs& a, const TaskArgs& b) {
         return std::get<TASKARGS_TS_POS>(a) > std::get<TASKARGS_TS_POS>(b);
@@ -131,9 +367,34 @@ inline uint64_t GetTimestamp(const TaskArgs& a) {
     return std::get<TASKARGS_TS_POS>(a);
 }
 
+#ifdef PLS_BUCKET_QUEUE
+// Drains one bucket's contiguous TaskArgs at a time, instead of chasing
+// pairing-heap nodes
+using PriorityQueue = BucketQueue<TaskArgs, GetTimestamp>;
+#else
 //using PriorityQueue = std::priority_queue<TaskArgs, std::vector<TaskArgs>, CompareTasks>;
 // pbds pairing_heap works better than std heap on non-native types
 using PriorityQueue = dtpq<TaskArgs, __gnu_pbds::priority_queue<TaskArgs, CompareTasks>, GetTimestamp>;
+#endif
+
+// Run a dequeued task: peel the uid and/or function index off the front of
+// the tuple and pass the rest (timestamp included) to the task function.
+static inline void __callTaskArgs(const TaskArgs& args) {
+#ifdef PLS_SINGLE_TASKFUNC
+#ifndef SWTASKS_USE_UID
+    callFuncTuple(PLS_SINGLE_TASKFUNC, args);
+#else
+    callFuncTupleIgnoringFirstArg(PLS_SINGLE_TASKFUNC, args);
+#endif
+#else  // PLS_TASKFUNC_REGISTRY
+    __RegistryFn* f = __TaskRegistry::table[std::get<TASKARGS_FN_POS>(args)];
+#ifndef SWTASKS_USE_UID
+    callFuncTupleIgnoringFirstArg(f, args);
+#else
+    callFuncTupleIgnoringFirst2Args(f, args);
+#endif
+#endif
+}
 
 #endif
 
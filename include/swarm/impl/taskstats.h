@@ -0,0 +1,157 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#pragma once
+
+#ifndef FROM_PLS_API
+#error "This file cannot be included directly"
+#endif
+
+/* Per-task-function statistics for the software-queued runtimes (seq/TLS).
+ * Define PLS_TASK_STATS to see which task functions dominate enqueue volume
+ * and queue residency without simulator-side post-processing. When it is not
+ * defined, all hooks compile away.
+ *
+ * Each Task<F, f> instantiation registers one record on first enqueue, and
+ * the hot paths just bump per-thread cache-line-aligned counters of enqueues,
+ * dequeues, and enqueue-to-dequeue rdtsc cycles (the task carries its enqueue
+ * cycle; see TaskState in swtasks.h). Threads only touch their own line, so
+ * under TLS the counters never conflict across speculative tasks.
+ *
+ * A ranked report prints when swarm::run() drains the queue (seq) or through
+ * the simulator's end handler (TLS). Functions are reported by address; map
+ * them to names with nm or addr2line on the benchmark binary.
+ */
+#ifdef PLS_TASK_STATS
+
+#ifdef PLS_SINGLE_TASKFUNC
+#error "PLS_TASK_STATS is pointless with PLS_SINGLE_TASKFUNC (one function)"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdlib.h>
+#include <vector>
+#include <x86intrin.h>
+
+#include "types.h"
+
+namespace swarm {
+
+struct TaskFnStats {
+    // An upper bound so counters can be sized before threads are launched
+    static constexpr uint32_t kMaxThreads = 256;
+
+    struct alignas(SWARM_CACHE_LINE) Counters {
+        uint64_t enqueues;
+        uint64_t dequeues;
+        uint64_t residency;  // rdtsc cycles from enqueue to dequeue
+    };
+
+    uintptr_t fp;
+    Counters* counters;  // one line per thread
+};
+
+struct TaskStatsRegistry {
+    std::vector<TaskFnStats*> fns;
+    std::atomic<uint32_t> nextTid{0};
+};
+
+// [victory] C++17 would allow defining an inline variable in this header
+// file. But since we want to support older versions of GCC, lets use the
+// static-member-of-class-template trick. See: https://wg21.link/n4424
+template <typename T> struct __TaskStatsState {
+    static TaskStatsRegistry registry;
+    static __thread int32_t tid;
+};
+template <typename T> TaskStatsRegistry __TaskStatsState<T>::registry;
+template <typename T> __thread int32_t __TaskStatsState<T>::tid = -1;
+static TaskStatsRegistry& __taskStatsRegistry = __TaskStatsState<int>::registry;
+
+// A compact thread index assigned on first use, so the counter arrays don't
+// depend on any runtime's thread-id plumbing
+static inline uint32_t __taskStatsTid() {
+    int32_t& t = __TaskStatsState<int>::tid;
+    if (pls_unlikely(t < 0))
+        t = __taskStatsRegistry.nextTid.fetch_add(1) % TaskFnStats::kMaxThreads;
+    return t;
+}
+
+static inline TaskFnStats* __registerTaskFn(uintptr_t fp) {
+    auto* s = new TaskFnStats();
+    s->fp = fp;
+    void* mem;
+    int res = posix_memalign(&mem, SWARM_CACHE_LINE,
+            TaskFnStats::kMaxThreads * sizeof(TaskFnStats::Counters));
+    if (res != 0) std::abort();
+    std::memset(mem, 0,
+            TaskFnStats::kMaxThreads * sizeof(TaskFnStats::Counters));
+    s->counters = static_cast<TaskFnStats::Counters*>(mem);
+    // Registration races (TLS) are resolved by the simulator's speculation,
+    // like all other shared state in these runtimes
+    __taskStatsRegistry.fns.push_back(s);
+    return s;
+}
+
+template <typename F, F* f>
+static inline TaskFnStats& __taskStatsFor() {
+    static TaskFnStats* s = __registerTaskFn(reinterpret_cast<uintptr_t>(f));
+    return *s;
+}
+
+static inline void __statsEnqueue(TaskFnStats* s) {
+    s->counters[__taskStatsTid()].enqueues++;
+}
+
+static inline void __statsDequeue(TaskFnStats* s, uint64_t enqCycle) {
+    auto& c = s->counters[__taskStatsTid()];
+    c.dequeues++;
+    c.residency += __rdtsc() - enqCycle;
+}
+
+static void __printTaskStats() {
+    struct Row { uintptr_t fp; uint64_t enq, deq, res; };
+    std::vector<Row> rows;
+    for (const TaskFnStats* s : __taskStatsRegistry.fns) {
+        Row r = {s->fp, 0, 0, 0};
+        for (uint32_t t = 0; t < TaskFnStats::kMaxThreads; t++) {
+            r.enq += s->counters[t].enqueues;
+            r.deq += s->counters[t].dequeues;
+            r.res += s->counters[t].residency;
+        }
+        rows.push_back(r);
+    }
+    std::sort(rows.begin(), rows.end(),
+              [] (const Row& a, const Row& b) { return a.enq > b.enq; });
+    printf("[" HOOKS_STR "] Per-taskfn stats (map fps with nm/addr2line):\n");
+    printf("[" HOOKS_STR "] %18s %14s %14s %16s\n",
+           "taskfn", "enqueues", "dequeues", "avg residency");
+    for (const Row& r : rows) {
+        printf("[" HOOKS_STR "] 0x%016lx %14lu %14lu %16.0f\n",
+               r.fp, r.enq, r.deq,
+               r.deq ? static_cast<double>(r.res) / r.deq : 0.0);
+    }
+    fflush(stdout);
+}
+
+}  // namespace swarm
+
+#endif  // PLS_TASK_STATS
@@ -33,7 +33,7 @@
 #include <tuple>
 #include "hwtasks.h"
 #include "hwmisc.h"
-#include "seq_tasks.h" // Don't support swarm::deepen yet
+#include "tls_tasks.h" // Don't support swarm::deepen yet
 
 namespace swarm {
 
@@ -41,18 +41,53 @@ namespace swarm {
 // The TLS runtime uses TLS... too many TLAs
 extern volatile __thread Timestamp minTs __attribute__((aligned(SWARM_CACHE_LINE)));
 
+// Number of software tasks each tlsTask invocation drains before
+// re-enqueuing itself. Every invocation costs a full hardware dispatch round
+// trip, which dominates short tasks; batches amortize it, but publish minTs
+// only once per batch, so other threads order against a staler minimum.
+#ifndef PLS_TLS_DEQUEUE_BATCH
+#define PLS_TLS_DEQUEUE_BATCH 1
+#endif
+// A batch also ends early once the queue minimum rises more than this far
+// past the batch's first timestamp, bounding how much the drained tasks can
+// run ahead of timestamp order.
+#ifndef PLS_TLS_BATCH_MAX_SKEW
+#define PLS_TLS_BATCH_MAX_SKEW UINT64_MAX
+#endif
+
 static inline void tlsTask(uint64_t ts) {
-    // Try to get a task, as in the SW runtime
-    if (pq.empty()) return;
-#ifndef PLS_SINGLE_TASKFUNC
-    TaskState* t = pq.dequeueTop();
-    minTs = pq.empty()? GetTimestamp(t) : pq.minTs();
-    t->call();
+    // Try to get tasks from our shard (stealing if it is empty),
+    // as in the SW runtime
+    Timestamp batchFirst = UINT64_MAX;
+    Timestamp last = ts;
+    for (uint32_t drained = 0; drained < PLS_TLS_DEQUEUE_BATCH; drained++) {
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
+        TaskState* t;
+        if (!spq.tryDequeueTop(&t)) break;
+#ifdef PLS_TASK_STATS
+        __statsDequeue(t->stats, t->enqCycle);
+#endif
+        last = GetTimestamp(t);
+        if (batchFirst == UINT64_MAX) batchFirst = last;
+        t->call();
+        delete t;  // recycles through the TaskPool
 #else
-    auto args = pq.dequeueTop();
-    minTs = pq.empty()? GetTimestamp(args) : pq.minTs();
-    callFuncTuple(PLS_SINGLE_TASKFUNC, args);
+        TaskArgs args;
+        if (!spq.tryDequeueTop(&args)) break;
+        last = GetTimestamp(args);
+        if (batchFirst == UINT64_MAX) batchFirst = last;
+        __callTaskArgs(args);
 #endif
+        // The guard folds away at the default batch size of 1
+        if (drained + 1 < PLS_TLS_DEQUEUE_BATCH &&
+                spq.minTs() - batchFirst > PLS_TLS_BATCH_MAX_SKEW) break;
+    }
+    if (batchFirst == UINT64_MAX) return;  // the queues were empty
+
+    // Publish the minimum after the whole batch (any earlier task enqueued
+    // during the batch already lowered minTs via enqueueTask)
+    Timestamp qMin = spq.minTs();
+    minTs = (qMin == UINT64_MAX)? last : qMin;
 
     __enqueueHwTask<decltype(tlsTask), tlsTask>(minTs, EnqFlags(SAMEHINT | SAMETASK));
 }
@@ -66,6 +101,10 @@ static void* tls_worker(void* arg /* unused */) {
 
 static inline void run() {
     setup_task_handlers();
+#ifdef PLS_TASK_STATS
+    // Workers never return, so report through the simulator's end handler
+    sim_register_end_handler(__printTaskStats);
+#endif
     uint32_t nthreads = num_threads();
     for (uint32_t t = 0; t < nthreads; t++) {
         // One per core; should have per-core ROBs for this to work well...
@@ -77,7 +116,7 @@ static inline void run() {
 template<typename F, F* f, typename... Args>
 void enqueueTask(Timestamp ts, Hint hint, Args... args) {
    if (ts < minTs) minTs = ts;
-    __enqueueSwTask<F, f, Args...>(ts, hint, args...);
+    __enqueueTlsTask<F, f, Args...>(ts, hint, args...);
 }
 
 } // namespace swarm
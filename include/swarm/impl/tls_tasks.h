@@ -0,0 +1,182 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#pragma once
+
+#ifndef FROM_PLS_API
+#error "This file cannot be included directly"
+#endif
+
+// Sharded software priority queue for the TLS runtime. The single global pq in
+// seq_tasks.h serializes all worker threads on one heap and one minTs update
+// path; with many threads the queue becomes the bottleneck long before the
+// application does. Here each thread owns a shard (heap + cache-line-padded
+// minimum-timestamp estimate). Pushes go to the enqueuer's own shard, pops
+// come from the dequeuer's own shard, and an empty thread steals from the
+// shard advertising the earliest timestamp. As with the unsharded queue, we
+// rely on the simulator's speculation to resolve races on shard state; no
+// locks are needed or wanted here.
+
+#include <cstdlib>
+#include <new>
+#include "swtasks.h"
+
+namespace swarm {
+
+class ShardedPriorityQueue {
+    struct alignas(SWARM_CACHE_LINE) Shard {
+        PriorityQueue pq;
+        // UINT64_MAX when the shard is empty. This is an estimate: it is
+        // updated only by the shard's push/pop paths, so a stale value merely
+        // misdirects a steal or delays a minTs() drop, never loses a task.
+        Timestamp cachedMin;
+        Shard() : cachedMin(UINT64_MAX) {}
+
+        inline void refresh() {
+            cachedMin = pq.empty() ? UINT64_MAX : pq.minTs();
+        }
+    };
+
+    Shard* shards;
+    uint32_t nshards;
+
+    inline Shard& local() { return shards[swarm::tid() % nshards]; }
+
+    inline void lazyInit() {
+        if (pls_unlikely(!shards)) {
+            nshards = swarm::num_threads();
+            // C++14 new[] does not honor extended alignment; carve the shards
+            // out of an explicitly aligned allocation instead.
+            void* b = nullptr;
+            int err = posix_memalign(&b, SWARM_CACHE_LINE,
+                                     nshards * sizeof(Shard));
+            if (err != 0) std::abort();
+            shards = static_cast<Shard*>(b);
+            for (uint32_t i = 0; i < nshards; i++) new (&shards[i]) Shard();
+        }
+    }
+
+  public:
+    ShardedPriorityQueue() : shards(nullptr), nshards(0) {}
+
+    template <typename T>
+    inline void push(T entry) {
+        lazyInit();
+        Shard& s = local();
+        Timestamp ts = GetTimestamp(entry);
+        s.pq.push(entry);
+        if (ts < s.cachedMin) s.cachedMin = ts;
+    }
+
+    inline bool empty() const {
+        if (!shards) return true;
+        for (uint32_t i = 0; i < nshards; i++)
+            if (shards[i].cachedMin != UINT64_MAX) return false;
+        return true;
+    }
+
+    // Low-contention global-minimum estimate: a read-only scan of the padded
+    // per-shard estimates, not the heaps themselves.
+    inline Timestamp minTs() const {
+        Timestamp min = UINT64_MAX;
+        for (uint32_t i = 0; i < nshards; i++)
+            min = std::min(min, (Timestamp)shards[i].cachedMin);
+        return min;
+    }
+
+    // Pop from the local shard, or steal from the shard with the earliest
+    // advertised timestamp. Returns true and fills *entry on success.
+    template <typename T>
+    inline bool tryDequeueTop(T* entry) {
+        if (pls_unlikely(!shards)) return false;
+        Shard* victim = &local();
+        if (victim->pq.empty()) {
+            // Timestamp-aware steal: prefer the shard holding the earliest
+            // task, so stealing also keeps execution close to timestamp order.
+            victim = nullptr;
+            Timestamp best = UINT64_MAX;
+            for (uint32_t i = 0; i < nshards; i++) {
+                Timestamp m = shards[i].cachedMin;
+                if (m < best) {
+                    best = m;
+                    victim = &shards[i];
+                }
+            }
+            if (!victim || victim->pq.empty()) {
+                // Raced with another dequeuer; let the caller retry later.
+                if (victim) victim->refresh();
+                return false;
+            }
+        }
+        *entry = victim->pq.dequeueTop();
+        victim->refresh();
+        return true;
+    }
+};
+
+// [victory] C++17 would allow defining an inline variable in this header file.
+// But since we want to support older versions of GCC, lets use the
+// static-member-of-class-template trick.  See: https://wg21.link/n4424
+template <typename T> struct __TlsTasks {
+  static ShardedPriorityQueue spq;
+};
+template <typename T> ShardedPriorityQueue __TlsTasks<T>::spq;
+static ShardedPriorityQueue& spq = __TlsTasks<int>::spq;
+
+#if !defined(PLS_SINGLE_TASKFUNC) && !defined(PLS_TASKFUNC_REGISTRY)
+
+template<typename F, F* f, typename... Args>
+void __enqueueTlsTask(Timestamp ts, Hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    auto* t = new Task<F, f, Args...>(ts, args...);
+#ifdef PLS_TASK_STATS
+    t->stats = &__taskStatsFor<F, f>();
+    t->enqCycle = __rdtsc();
+    __statsEnqueue(t->stats);
+#endif
+    spq.push(t);
+}
+
+#elif defined(PLS_SINGLE_TASKFUNC)
+
+template<typename F, F* f, typename... Args>
+void __enqueueTlsTask(Timestamp ts, Hint, Args... args) {
+    static_assert(f == PLS_SINGLE_TASKFUNC, "PLS_SINGLE_TASKFUNC defined, but does not match enqueued function.");
+
+    spq.push(TaskArgs(ts, args...));
+}
+
+#else  // PLS_TASKFUNC_REGISTRY
+
+template<typename F, F* f, typename... Args>
+void __enqueueTlsTask(Timestamp ts, Hint, Args... args) {
+    if (false) {
+        // Check it's a well-typed call
+        // If you see a compiler error here, you're using the wrong args...
+        f(ts, args...);
+    }
+    spq.push(TaskArgs(__RegistryIndexOf<F, f>::value, ts, args...));
+}
+
+#endif
+
+}
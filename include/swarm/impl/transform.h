@@ -28,16 +28,21 @@
 
 namespace swarm {
 
-template <class InputIt, class OutputIt, class UnaryOperation>
+// FineGrain forces one task per output cache line. By default each task
+// processes a grain of several aligned lines (sized by block::grainSize), as
+// on large arrays the enqueue/dequeue overhead of line-sized tasks exceeds
+// the work of transforming one line's elements. Force fine grains when the
+// output lines are expected hot in remote L2s, where a coarse task would
+// serialize several lines' worth of remote accesses that line-sized tasks
+// spread across tiles.
+template <bool FineGrain = false,
+          class InputIt, class OutputIt, class UnaryOperation>
 void transform(InputIt ifirst, InputIt ilast, OutputIt ofirst, UnaryOperation o,
                Timestamp ts) {
     pls_cbegin(ts, EnqFlags::NOHINT, [ifirst, ilast, ofirst, o]);
 
-    // TODO(mcj) verify that these are constexpr with c++14 by default.
     uint32_t blockSize = swarm::block::elementsPerLine<OutputIt>();
-    // TODO(mcj) there is a tradeoff between coarsening to several cachelines
-    // per task, vs locality of those cachelines, in case they were already
-    // present in the L2s
+    if (!FineGrain) blockSize *= swarm::block::grainSize(ifirst, ilast);
     uint32_t numTasks = 1 + (std::distance(ifirst, ilast) - 1) / blockSize;
     // TODO(mcj) deepen isn't strictly necessary, but an API would use it to
     // guarantee atomicity
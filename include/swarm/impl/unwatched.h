@@ -0,0 +1,79 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef FROM_PLS_API
+#error "This file cannot be included directly"
+#endif
+
+#include <type_traits>
+
+namespace swarm {
+
+/* Scoped untracked reads. swarm::clearReadSet() is all-or-nothing: a task
+ * that streams over a large read-mostly structure (e.g. CSR arrays) either
+ * tracks every line it touches, inflating its read-set and abort rate, or
+ * drops conflict detection for everything it has read. A read_unwatched
+ * region instead switches the core into the privileged mode the runtime's
+ * own services use, whose accesses bypass conflict tracking, and switches
+ * back on scope exit; accesses outside the region stay tracked as usual.
+ *
+ * Only use it to read data that no concurrent task writes: reads inside the
+ * region are not conflict-checked, and writes are forbidden (they would
+ * escape rollback). Since an abort cannot interrupt the region, long
+ * streaming loops should poll doomed() and bail out early.
+ */
+#if defined(SWARM_RUNTIME) || defined(TLS_RUNTIME)
+
+class read_unwatched {
+  public:
+    read_unwatched() { sim_priv_call(); }
+    ~read_unwatched() { sim_priv_ret(); }
+    read_unwatched(const read_unwatched&) = delete;
+    read_unwatched& operator=(const read_unwatched&) = delete;
+
+    // Whether the enclosing task has been aborted; the region runs on
+    // regardless, so poll this from long loops and return early
+    static bool doomed() { return sim_priv_isdoomed(); }
+};
+
+#else
+
+// The other runtimes don't conflict-check loads, so there is nothing to
+// leave out of a read-set
+class read_unwatched {
+  public:
+    read_unwatched() {}
+    ~read_unwatched() {}
+    read_unwatched(const read_unwatched&) = delete;
+    read_unwatched& operator=(const read_unwatched&) = delete;
+
+    static bool doomed() { return false; }
+};
+
+#endif
+
+// A single read that stays out of the task's read-set
+template <typename T>
+static inline T load_unwatched(const T* addr) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "swarm::load_unwatched requires trivially copyable values");
+    read_unwatched r;
+    return *addr;
+}
+
+}  // namespace swarm
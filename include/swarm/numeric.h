@@ -40,6 +40,34 @@ template <class Iterator, class T, class BinaryOp, class CallBack>
 static inline void reduce(Iterator first, Iterator last, T init, BinaryOp o,
         Timestamp ts, CallBack cb);
 
+/**
+ * Map-reduce variant: o folds an element into an accumulator, while c
+ * combines two already-folded partials (e.g. o adds a word's popcount to a
+ * running count; c adds two counts). The plain overload above is equivalent
+ * to passing c == o.
+ */
+template <class Iterator, class T, class BinaryOp, class CombineOp,
+          class CallBack>
+static inline void reduce(Iterator first, Iterator last, T init, BinaryOp o,
+        CombineOp c, Timestamp ts, CallBack cb);
+
+/**
+ * Parallel prefix sums over a non-empty contiguous range, with the same
+ * timestamp/callback convention as reduce: the scan appears atomic at ts, and
+ * cb is enqueued at ts with the total (the fold of the whole range) once the
+ * outputs are written. The first five arguments follow std::exclusive_scan /
+ * std::inclusive_scan; [first, last) and the output range may be the same.
+ */
+template <class InputIt, class OutputIt, class T, class BinaryOp,
+          class CallBack>
+static inline void exclusive_scan(InputIt first, InputIt last,
+        OutputIt d_first, T init, BinaryOp o, Timestamp ts, CallBack cb);
+
+template <class InputIt, class OutputIt, class BinaryOp, class CallBack>
+static inline void inclusive_scan(InputIt first, InputIt last,
+        OutputIt d_first, BinaryOp o, Timestamp ts, CallBack cb);
+
 }
 
 #include "impl/reduce.h"
+#include "impl/scan.h"
@@ -0,0 +1,102 @@
+/** $lic$
+ * Copyright (C) 2014-2021 by Massachusetts Institute of Technology
+ *
+ * This file is distributed under the University of Illinois Open Source
+ * License. See LICENSE.TXT for details.
+ *
+ * If you use this software in your research, we request that you send us a
+ * citation of your work, and reference the Swarm MICRO 2015 paper ("A Scalable
+ * Architecture for Ordered Parallelism", Jeffrey et al., MICRO-48, December
+ * 2015) as the source of the simulator, or reference the T4 ISCA 2020 paper
+ * ("T4: Compiling Sequential Code for Effective Speculative Parallelization in
+ * Hardware", Ying et al., ISCA-47, June 2020) as the source of the compiler.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+// Placement-aware allocation. By default the simulated memory system hashes
+// cache lines across tiles, so data has no home a task hint can exploit.
+// swarm::mallocPartition overrides that for an address range, pinning it to
+// one tile's cache partition; these helpers pair such pinned ranges with the
+// NOHASH tile-ID hints (see api.h) that send the tasks there too.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#include "api.h"
+
+namespace swarm {
+
+// Allocate bytes pinned to the given tile's partition. Tasks that access the
+// allocation should be enqueued with hint {tile, EnqFlags::NOHASH}.
+static inline void* malloc_partitioned(size_t bytes, uint32_t tile) {
+    void* p;
+    if (posix_memalign(&p, SWARM_CACHE_LINE, bytes)) return nullptr;
+    swarm::mallocPartition(p, reinterpret_cast<char*>(p) + bytes, tile);
+    return p;
+}
+
+// One contiguous allocation carved into per-tile segments of consecutive
+// elements, each pinned to its owning tile. hint(i) yields the spatial hint
+// that sends a task to element i's tile, so the task's reads and writes of
+// its segment hit the local cache.
+template <typename T>
+class partitioned_array {
+    static_assert(std::is_trivial<T>::value,
+                  "swarm::partitioned_array elements must be trivial");
+
+    char* base;
+    const size_t n;
+    const uint32_t nsegs;
+    const size_t segElems;
+    const size_t segBytes;  // segment stride, a whole number of lines
+
+  public:
+    partitioned_array(size_t _n)
+        : base(nullptr)
+        , n(_n)
+        // As in swarm::reduce, the min handles the oracle runtime's
+        // effectively unbounded numTiles()
+        , nsegs(std::min(swarm::numTiles(), swarm::num_threads()))
+        , segElems(std::max((n + nsegs - 1) / nsegs, 1ul))
+        , segBytes(((segElems * sizeof(T) + SWARM_CACHE_LINE - 1)
+                    / SWARM_CACHE_LINE) * SWARM_CACHE_LINE)
+    {
+        if (posix_memalign(reinterpret_cast<void**>(&base),
+                           SWARM_CACHE_LINE, nsegs * segBytes))
+            std::abort();
+        // Segments are line-aligned, so pinning one never strands another
+        // tile's elements
+        for (uint32_t t = 0; t < nsegs; t++)
+            swarm::mallocPartition(base + t * segBytes,
+                                   base + (t + 1) * segBytes, t);
+    }
+    ~partitioned_array() { free(base); }
+
+    partitioned_array(const partitioned_array&) = delete;
+    partitioned_array& operator=(const partitioned_array&) = delete;
+
+    size_t size() const { return n; }
+
+    // The tile that owns element i
+    uint32_t tile(size_t i) const { return i / segElems; }
+
+    // The spatial hint that sends a task to element i's tile
+    Hint hint(size_t i) const { return {tile(i), EnqFlags::NOHASH}; }
+
+    T& operator[](size_t i) {
+        return *reinterpret_cast<T*>(
+                base + tile(i) * segBytes + (i % segElems) * sizeof(T));
+    }
+    const T& operator[](size_t i) const {
+        return *reinterpret_cast<const T*>(
+                base + tile(i) * segBytes + (i % segElems) * sizeof(T));
+    }
+};
+
+}  // end namespace swarm
@@ -37,6 +37,44 @@ static inline uint64_t swarm_rand64(void) {
 // Expose the (preferred) C++ API
 namespace swarm {
 static inline uint64_t rand64() { return swarm_rand64(); }
+
+// Counter-based PRNG for hot loops: sim_rdrand is a simulator trap, so
+// rand64 is far too expensive to call per number (e.g. for hint
+// randomization or sampling). prng is pure ALU work and stateless: it keys
+// a SplitMix64-style finalizer by (timestamp, tid, sequence), so every
+// task gets an independent stream that is reproducible across runs and
+// schedules. Pass swarm::tid() (or any per-task discriminator) as tid to
+// separate the streams of tasks sharing a timestamp, and number the draws
+// within a task with seq.
+
+// See __HWMiscState (hwmisc.h) for why this isn't a plain inline variable
+template <typename T> struct __PrngState { static uint64_t seed; };
+template <typename T> uint64_t __PrngState<T>::seed = 0;
+
+// Optionally call once before launching threads to decorrelate runs,
+// e.g. prng_seed(swarm::rand64()); rand64 stays the entropy source.
+// The default seed of 0 gives deterministic, reproducible streams.
+static inline void prng_seed(uint64_t s) { __PrngState<int>::seed = s; }
+
+// SplitMix64's finalizer (Steele et al., OOPSLA 2014)
+static inline uint64_t __prngMix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ul;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebul;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t prng(uint64_t ts, uint64_t tid, uint64_t seq) {
+    uint64_t z = __PrngState<int>::seed;
+    z = __prngMix(z ^ (ts + 0x9e3779b97f4a7c15ul));
+    z = __prngMix(z ^ (tid + 0xd1b54a32d192ed03ul));
+    z = __prngMix(z ^ (seq + 0x8bb84b93962eacc9ul));
+    return z;
+}
+
+static inline uint64_t prng(uint64_t ts, uint64_t seq) {
+    return prng(ts, 0ul, seq);
+}
+
 }
 
 #endif
@@ -23,23 +23,94 @@
 
 #include "swarm/hooks.h"
 
+/* Every MAGIC_OP_ALLOC-family call is a simulator trap, so allocation-heavy
+ * task code used to trap on every malloc and free. Instead, keep a per-thread
+ * free-list cache of small blocks, bucketed by power-of-two size class: a
+ * free pushes the block onto the thread's list and a later malloc pops it,
+ * with no magic op in the steady state. The simulator's tracking is
+ * preserved at the batch boundaries: on a cache miss we fetch
+ * SIMALLOC_REFILL blocks with consecutive MAGIC_OP_ALLOCs, and when a list
+ * grows past SIMALLOC_MAX_CACHED we return half of it with consecutive
+ * MAGIC_OP_FREEs, so every block's lifetime is still delimited by the usual
+ * magic ops (just batched, and covering cache residency).
+ *
+ * To classify a pointer in free and malloc_usable_size without trapping,
+ * every block (small or large) carries a 16-byte header holding its size
+ * class and the base pointer the simulator knows about. */
+
+#define SIMALLOC_NCLASSES 6u   /* payloads of 8, 16, ..., 256 bytes */
+#define SIMALLOC_MAX_SMALL 256ul
+#define SIMALLOC_REFILL 32u      /* blocks fetched from the sim per miss */
+#define SIMALLOC_MAX_CACHED 64u  /* per class; flush half when reached */
+
+#define SIMALLOC_LARGE ((uint64_t)-1)
+
+typedef struct {
+    uint64_t cls;  /* size class, or SIMALLOC_LARGE */
+    void* base;    /* the pointer the simulator tracks */
+} simalloc_header_t;
+
+typedef struct simalloc_node {
+    struct simalloc_node* next;
+} simalloc_node_t;
+
+static _Thread_local simalloc_node_t* simalloc_lists[SIMALLOC_NCLASSES];
+static _Thread_local uint32_t simalloc_counts[SIMALLOC_NCLASSES];
+
+static inline size_t simalloc_class_bytes(uint32_t c) { return 8ul << c; }
+
+static inline uint32_t simalloc_class(size_t size) {
+    uint32_t c = 0;
+    while (simalloc_class_bytes(c) < size) c++;
+    return c;
+}
+
+static inline void* simalloc_sim_alloc(size_t size) {
+    void* ptr;
+    sim_magic_op_2(MAGIC_OP_ALLOC, (uint64_t)(&ptr), size);
+    return ptr;
+}
+
+static inline void simalloc_sim_free(void* ptr) {
+    sim_magic_op_1(MAGIC_OP_FREE, (uint64_t)(ptr));
+}
+
 void* malloc(size_t size) {
-    if (size > 0) {
-        void* ptr;
-        sim_magic_op_2(MAGIC_OP_ALLOC, (uint64_t)(&ptr), size);
-        return ptr;
+    if (size == 0) return NULL;
+    simalloc_header_t* h;
+    if (size <= SIMALLOC_MAX_SMALL) {
+        uint32_t c = simalloc_class(size);
+        simalloc_node_t* n = simalloc_lists[c];
+        if (n) {
+            simalloc_lists[c] = n->next;
+            simalloc_counts[c]--;
+            h = (simalloc_header_t*)n;
+        } else {
+            size_t bytes = sizeof(simalloc_header_t) + simalloc_class_bytes(c);
+            for (uint32_t i = 0; i < SIMALLOC_REFILL - 1; i++) {
+                simalloc_node_t* m = simalloc_sim_alloc(bytes);
+                m->next = simalloc_lists[c];
+                simalloc_lists[c] = m;
+            }
+            simalloc_counts[c] += SIMALLOC_REFILL - 1;
+            h = simalloc_sim_alloc(bytes);
+        }
+        h->cls = c;
     } else {
-        return NULL;
+        h = simalloc_sim_alloc(sizeof(simalloc_header_t) + size);
+        h->cls = SIMALLOC_LARGE;
     }
+    h->base = h;
+    return h + 1;
 }
 
 void* calloc(size_t nmemb, size_t size) {
     const size_t total = nmemb * size;
-    void* ptr;
-    sim_magic_op_2(MAGIC_OP_ALLOC, (uint64_t)(&ptr), total);
-    // NOTE: sim returns pre-zeroed mem, so you can comment out this memset,
-    // but apps should avoid calloc-ing lots of memory in parallel tasks.
-    memset(ptr, 0, total);
+    void* ptr = malloc(total);
+    // Cached blocks are recycled dirty, so we can no longer rely on the
+    // sim's pre-zeroed memory. Apps should avoid calloc-ing lots of memory
+    // in parallel tasks.
+    if (ptr) memset(ptr, 0, total);
     return ptr;
 }
 
@@ -67,7 +138,24 @@ void* realloc(void* ptr, size_t size) {
 }
 
 void free(void* ptr) {
-    if (ptr) sim_magic_op_1(MAGIC_OP_FREE, (uint64_t)(ptr));
+    if (!ptr) return;
+    simalloc_header_t* h = (simalloc_header_t*)ptr - 1;
+    if (h->cls == SIMALLOC_LARGE) {
+        simalloc_sim_free(h->base);
+        return;
+    }
+    uint32_t c = (uint32_t)h->cls;
+    simalloc_node_t* n = (simalloc_node_t*)h;
+    n->next = simalloc_lists[c];
+    simalloc_lists[c] = n;
+    if (++simalloc_counts[c] >= SIMALLOC_MAX_CACHED) {
+        for (uint32_t i = 0; i < SIMALLOC_MAX_CACHED / 2; i++) {
+            simalloc_node_t* m = simalloc_lists[c];
+            simalloc_lists[c] = m->next;
+            simalloc_sim_free(m);
+        }
+        simalloc_counts[c] -= SIMALLOC_MAX_CACHED / 2;
+    }
 }
 
 void cfree(void* ptr) { free(ptr); }
@@ -80,11 +168,20 @@ int posix_memalign(void **memptr, size_t alignment, size_t size) {
                || (alignment % sizeof(void*))) {
         return EINVAL;
     } else {
-        void* ptr;
+        // Pad so the returned pointer is aligned with a header just below
+        // it; pad is a multiple of alignment since alignment is a power of
+        // two and sizeof(simalloc_header_t) is 16
+        size_t pad = (alignment > sizeof(simalloc_header_t)) ?
+                alignment : sizeof(simalloc_header_t);
+        void* base;
         sim_magic_op_3(MAGIC_OP_POSIX_MEMALIGN,
-                       (uint64_t)(&ptr),
-                       alignment, size);
-        if (ptr == NULL) return ENOMEM;
+                       (uint64_t)(&base),
+                       alignment, size + pad);
+        if (base == NULL) return ENOMEM;
+        void* ptr = (char*)base + pad;
+        simalloc_header_t* h = (simalloc_header_t*)ptr - 1;
+        h->cls = SIMALLOC_LARGE;
+        h->base = base;
         *memptr = ptr;
     }
     return 0;
@@ -120,9 +217,14 @@ char* strdup(const char* src) {
 #pragma GCC diagnostic pop
 
 size_t malloc_usable_size(void* ptr) {
+    if (!ptr) return 0;
+    simalloc_header_t* h = (simalloc_header_t*)ptr - 1;
+    if (h->cls != SIMALLOC_LARGE)
+        return simalloc_class_bytes((uint32_t)h->cls);
     size_t usableSize;
-    sim_magic_op_2(MAGIC_OP_MALLOC_USABLE_SIZE, (uint64_t)(&usableSize), (uint64_t)(ptr));
-    return usableSize;
+    sim_magic_op_2(MAGIC_OP_MALLOC_USABLE_SIZE, (uint64_t)(&usableSize),
+                   (uint64_t)(h->base));
+    return usableSize - ((char*)ptr - (char*)h->base);
 }
 
 /* Unimplemented functions below. Programs rarely use these, so rather than